@@ -61,9 +61,9 @@ void Accel::init(){
 
 void Accel::calibrate(){
   // load from eeprom
-  zero[XAXIS] = eeprom_read_int(EEPROM_ADDR_ACCEL_PITCH);
-  zero[YAXIS] = eeprom_read_int(EEPROM_ADDR_ACCEL_ROLL);
-  zero[ZAXIS] = eeprom_read_int(EEPROM_ADDR_ACCEL_YAW);
+  for (byte axis = XAXIS; axis <= ZAXIS; axis++){
+    zero[axis] = config.accelZero[axis];
+  }
   
   /*Serial.print("Accel zeros: ");
   Serial.print(zero[PITCH]);
@@ -77,32 +77,29 @@ void Accel::calibrate(){
 // This assumes your platform is truly level!
 // See also: http://www.freescale.com/files/sensors/doc/app_note/AN3447.pdf
 void Accel::autoZero(){
-  // Take 50 measurements of all 3 axis, find the median, that's our zero-point
-  // Why 50? Because that's what the aeroquad project does
-  byte loopCount = 50;
-  
+  // Take ZERO_SAMPLES measurements of all 3 axis, find the median, that's our zero-point
   //Serial.print("Starting accel autoZero with ");
-  //Serial.print(loopCount, DEC);
+  //Serial.print(ZERO_SAMPLES, DEC);
   //Serial.println(" iterations.");
-  int findZero[loopCount];
+  int findZero[ZERO_SAMPLES];
   for (byte axis = XAXIS; axis <= ZAXIS; axis++){
-    for (byte i=0; i<loopCount; i++){
+    for (byte i=0; i<ZERO_SAMPLES; i++){
       sendReadRequest(0x32 + (axis * 2));
-      findZero[i] = readWordFlip();
+      findZero[i] = (int16_t)readWordFlip();
       delay(10);
     }
     
-    zero[axis] = findMedian(findZero, loopCount);
+    zero[axis] = findMedian(findZero, ZERO_SAMPLES);
     /*Serial.print("Zero of accel axis ");
     Serial.print(axis, DEC);
     Serial.print(" is: ");
     Serial.println(zero[axis]);*/
   }
   
-  // Write to eeprom
-  eeprom_write(EEPROM_ADDR_ACCEL_PITCH, zero[XAXIS]);
-  eeprom_write(EEPROM_ADDR_ACCEL_ROLL, zero[YAXIS]);
-  eeprom_write(EEPROM_ADDR_ACCEL_YAW, zero[ZAXIS]);
+  // Into the eeprom config, for whoever stores it next (see saveConfig())
+  for (byte axis = XAXIS; axis <= ZAXIS; axis++){
+    config.accelZero[axis] = zero[axis];
+  }
 }
 
 // Updates all raw measurements from the accelerometer
@@ -111,7 +108,7 @@ void Accel::updateAll(){
   requestBytes(6);
 
   for (byte axis = XAXIS; axis <= ZAXIS; axis++) {
-     dataRaw[axis] = zero[axis] - readNextWordFlip();
+     dataRaw[axis] = zero[axis] - (int16_t)readNextWordFlip();
      dataSmoothed[axis] = filterSmooth(gConstant[axis] * dataRaw[axis] + gB[axis], dataSmoothed[axis], _smoothFactor);
   }
 }
@@ -184,3 +181,14 @@ int Accel::getRawYaw(){
 float Accel::getSmoothFactor(){
   return _smoothFactor;
 }
+
+void Accel::setSmoothFactor(float smoothFactor){
+  _smoothFactor = constrain(smoothFactor, 0.01, 1.0);
+}
+
+// Stand-in smoothed data, in Gs, for running the angle maths without the sensor (see Benchmark.cpp)
+void Accel::setSmoothed(float x, float y, float z){
+  dataSmoothed[XAXIS] = x;
+  dataSmoothed[YAXIS] = y;
+  dataSmoothed[ZAXIS] = z;
+}
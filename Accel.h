@@ -50,10 +50,11 @@ class Accel : public I2C
     int getRawYaw();
     
     float getSmoothFactor();
+    void setSmoothFactor(float);
     
-  private:
-    I2C _i2c;
+    void setSmoothed(float, float, float);
     
+  private:
     int dataRaw[3]; // Raw and unfiltered accel data
     float dataSmoothed[3]; // Smoothed accel data
     int zero[3]; // Zero points for the accel axes
@@ -0,0 +1,154 @@
+/*
+  Autotune.cpp - Library for finding PID gains with a relay feedback (Astrom-Hagglund) experiment
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Instead of a PID, we drive the axis with a bang-bang relay of +/- AUTOTUNE_RELAY around the target.
+// The craft will settle into a limit cycle, and the size and period of that oscillation tell us
+// the ultimate gain (Ku) and ultimate period (Tu) of the axis. From there, Ziegler-Nichols gives us gains.
+//
+// See also: http://en.wikipedia.org/wiki/Ziegler%E2%80%93Nichols_method
+//
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "Autotune.h"
+
+Autotune::Autotune(){
+  _state = AUTOTUNE_IDLE;
+  _axis = ROLL;
+  _ku = 0;
+  _tu = 0;
+}
+
+// Begin tuning an axis from scratch
+void Autotune::start(byte axis){
+  _axis = axis;
+  _ku = 0;
+  _tu = 0;
+  reset();
+}
+
+// Throw away any measurements so far, but keep tuning the same axis
+void Autotune::reset(){
+  _state = AUTOTUNE_RUNNING;
+  _relayHigh = true;
+  _max = -360;
+  _min = 360;
+  _startTime = micros();
+  _riseTime = 0;
+  _cycles = 0;
+  _amplitudeSum = 0;
+  _periodSum = 0;
+}
+
+void Autotune::stop(){
+  _state = AUTOTUNE_IDLE;
+}
+
+// Returns the relay output for this axis, in motor units
+// target and cur are in degrees
+float Autotune::update(float target, float cur){
+  if (_state != AUTOTUNE_RUNNING) return 0;
+  
+  unsigned long currentTime = micros();
+  
+  // If it's getting away from us, give up and let the PIDs have it back
+  if (cur > AUTOTUNE_MAX_ANGLE || cur < -AUTOTUNE_MAX_ANGLE || currentTime - _startTime > AUTOTUNE_TIMEOUT){
+    _state = AUTOTUNE_ABORTED;
+    return 0;
+  }
+  
+  if (cur > _max) _max = cur;
+  if (cur < _min) _min = cur;
+  
+  float error = target - cur;
+  
+  if (_relayHigh && error < -AUTOTUNE_HYSTERESIS){
+    _relayHigh = false;
+  }
+  else if (!_relayHigh && error > AUTOTUNE_HYSTERESIS){
+    _relayHigh = true;
+    
+    // A full cycle is rising edge to rising edge
+    if (_riseTime != 0){
+      // The first few cycles are the craft settling into the oscillation, so skip them
+      if (_cycles >= AUTOTUNE_SKIP_CYCLES){
+        _amplitudeSum += (_max - _min) / 2;
+        _periodSum += (currentTime - _riseTime) / 1000000.0;
+      }
+      _cycles++;
+      
+      if (_cycles >= AUTOTUNE_SKIP_CYCLES + AUTOTUNE_CYCLES){
+        float amplitude = _amplitudeSum / AUTOTUNE_CYCLES;
+        _tu = _periodSum / AUTOTUNE_CYCLES;
+        
+        // Describing function of a relay with hysteresis
+        if (amplitude > AUTOTUNE_HYSTERESIS){
+          _ku = (4 * AUTOTUNE_RELAY) / (PI * sqrt(sq(amplitude) - sq(AUTOTUNE_HYSTERESIS)));
+          _state = AUTOTUNE_COMPLETE;
+        }
+        else{
+          _state = AUTOTUNE_ABORTED;
+        }
+        return 0;
+      }
+    }
+    
+    _riseTime = currentTime;
+    _max = cur;
+    _min = cur;
+  }
+  
+  return _relayHigh ? AUTOTUNE_RELAY : -AUTOTUNE_RELAY;
+}
+
+///////////
+
+byte Autotune::getState(){
+  return _state;
+}
+
+byte Autotune::getAxis(){
+  return _axis;
+}
+
+float Autotune::getUltimateGain(){
+  return _ku;
+}
+
+float Autotune::getUltimatePeriod(){
+  return _tu;
+}
+
+///////////
+
+// Classic Ziegler-Nichols, translated to how our PID class applies its gains:
+// I is multiplied by accumulated error*seconds, D by degrees/second
+float Autotune::getP(){
+  return 0.6 * _ku;
+}
+
+float Autotune::getI(){
+  if (_tu == 0) return 0;
+  return 1.2 * _ku / _tu;
+}
+
+float Autotune::getD(){
+  return 0.075 * _ku * _tu;
+}
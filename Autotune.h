@@ -0,0 +1,71 @@
+/*
+  Autotune.h - Library for finding PID gains with a relay feedback (Astrom-Hagglund) experiment
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Autotune_h
+#define Autotune_h
+
+#include "WProgram.h"
+#include "Definitions.h"
+
+#define AUTOTUNE_IDLE 0
+#define AUTOTUNE_RUNNING 1
+#define AUTOTUNE_COMPLETE 2
+#define AUTOTUNE_ABORTED 3
+
+class Autotune
+{
+  public:
+    Autotune();
+    
+    void start(byte);
+    void reset();
+    void stop();
+    
+    float update(float, float);
+    
+    byte getState();
+    byte getAxis();
+    
+    float getUltimateGain();
+    float getUltimatePeriod();
+    
+    // Proposed gains, only valid once we are complete
+    float getP();
+    float getI();
+    float getD();
+    
+  private:
+    byte _state;
+    byte _axis;
+    
+    boolean _relayHigh; // Which side of the relay are we on?
+    float _max; // Peaks of the oscillation for the current cycle
+    float _min;
+    
+    unsigned long _startTime;
+    unsigned long _riseTime; // When the relay last switched high
+    byte _cycles;
+    
+    float _amplitudeSum;
+    float _periodSum;
+    
+    float _ku; // Ultimate gain
+    float _tu; // Ultimate period, in seconds
+};
+
+#endif
@@ -37,6 +37,9 @@ Baro::Baro() : I2C(){
   // 2 = high
   // 3 = ultra high resolution
   _overSamplingSetting = 3;
+  
+  _ac4 = 0; // Never 0 once init() has read the real calibration
+  _state = BARO_IDLE;
 }
 
 void Baro::init(){
@@ -49,43 +52,53 @@ void Baro::init(){
   else{
     // Read calibration data
     // The barometer is calibrated at the factory, and those settings are written to EEPROM
-    sendReadRequest(0xAA);
-    _ac1 = readWord();
-    sendReadRequest(0xAC);
-    _ac2 = readWord();
-    sendReadRequest(0xAE);
-    _ac3 = readWord();
-    sendReadRequest(0xB0);
-    _ac4 = readWord();
-    sendReadRequest(0xB2);
-    _ac5 = readWord();
-    sendReadRequest(0xB4);
-    _ac6 = readWord();
-    sendReadRequest(0xB6);
-    _b1 = readWord();
-    sendReadRequest(0xB8);
-    _b2 = readWord();
-    sendReadRequest(0xBA);
-    _mb = readWord();
-    sendReadRequest(0xBC);
-    _mc = readWord();
-    sendReadRequest(0xBE);
-    _md = readWord();
+    int calibration[BARO_CALIBRATION_WORDS];
+    for (byte i = 0; i < BARO_CALIBRATION_WORDS; i++){
+      sendReadRequest(0xAA + i*2);
+      calibration[i] = (int16_t)readWord();
+    }
+    
+    setCalibration(calibration);
   }
 }
 
 // Calculate altitude from the barometer
+// A reading takes the chip about 30ms, so rather than wait for it, start a conversion and come back for the result
+// on a later loop. The altitude is updated each time a pressure reading comes in
 void Baro::measure(){
-  // read uncompensated temperature
-  readUT();
-
-  // read uncompensated pressure
-  readUP();
+  // Nothing answered in init(), and without its calibration the maths below divides by zero
+  if (!_ac4) return;
+  
+  switch (_state){
+    case BARO_IDLE:
+      requestUT();
+      break;
+    case BARO_TEMPERATURE:
+      // Wait at least 4.5ms
+      if (micros() - _requestTime < 5000) return;
+      
+      // read uncompensated temperature
+      readUT();
+      requestUP();
+      break;
+    case BARO_PRESSURE:
+      // Wait for conversion, time dependent on OSS
+      if (micros() - _requestTime < 26000) return;
+      
+      // read uncompensated pressure
+      readUP();
+      compensate(_ut, _up);
+      requestUT();
+      break;
+  }
+}
 
+// Turn raw readings into temperature, pressure and altitude, using the calibration
+void Baro::compensate(unsigned int ut, unsigned long up){
   // calculate true temperature
   long x1, x2, b5;
   
-  x1 = (((long)_ut - (long)_ac6) * (long)_ac5) >> 15;
+  x1 = (((long)ut - (long)_ac6) * (long)_ac5) >> 15;
   x2 = ((long)_mc << 11)/(x1 + _md);
   b5 = x1 + x2;
 
@@ -108,7 +121,7 @@ void Baro::measure(){
   x3 = ((x1 + x2) + 2) >> 2;
   b4 = (_ac4 * (unsigned long)(x3 + 32768)) >> 15;
   
-  b7 = ((unsigned long)(_up - b3) * (50000 >> _overSamplingSetting));
+  b7 = ((unsigned long)(up - b3) * (50000 >> _overSamplingSetting));
   if (b7 < 0x80000000)
     _pressure = (b7 << 1) / b4;
   else
@@ -123,28 +136,47 @@ void Baro::measure(){
   _altitude = (float)44330 * (1 - pow(((float) _pressure / _p0), 0.190295));
 }
 
-void Baro::readUT(){  
+// AC1 through MD, in the order the chip stores them
+void Baro::setCalibration(const int *calibration){
+  _ac1 = calibration[0];
+  _ac2 = calibration[1];
+  _ac3 = calibration[2];
+  _ac4 = (uint16_t)calibration[3];
+  _ac5 = (uint16_t)calibration[4];
+  _ac6 = (uint16_t)calibration[5];
+  _b1 = calibration[6];
+  _b2 = calibration[7];
+  _mb = calibration[8];
+  _mc = calibration[9];
+  _md = calibration[10];
+}
+
+void Baro::requestUT(){
   // Write 0x2E into Register 0xF4
   // This requests a temperature reading
   writeSetting(0xF4, 0x2E);
   
-  // Wait at least 4.5ms
-  delay(5);
-  
+  _requestTime = micros();
+  _state = BARO_TEMPERATURE;
+}
+
+void Baro::readUT(){  
   // Read two bytes from registers 0xF6 and 0xF7
   sendReadRequest(0xF6);
   _ut = readWord();
 }
 
-void Baro::readUP(){
-  unsigned char msb, lsb, xlsb;
-  
+void Baro::requestUP(){
   // Write 0x34+(_overSamplingSetting<<6) into register 0xF4
   // Request a pressure reading w/ oversampling setting
   writeSetting(0xF4, 0x34 + (_overSamplingSetting<<6));
   
-  // Wait for conversion, delay time dependent on OSS
-  delay(26);
+  _requestTime = micros();
+  _state = BARO_PRESSURE;
+}
+
+void Baro::readUP(){
+  unsigned char msb, lsb, xlsb;
 
   // Read register 0xF6 (MSB), 0xF7 (LSB), and 0xF8 (XLSB)
   sendReadRequest(0xF6);
@@ -24,6 +24,13 @@
 #include "Definitions.h"
 #include "I2C.h"
 
+#define BARO_CALIBRATION_WORDS 11
+
+// What measure() is waiting on
+#define BARO_IDLE 0
+#define BARO_TEMPERATURE 1
+#define BARO_PRESSURE 2
+
 class Baro : public I2C
 {
   public:
@@ -31,31 +38,36 @@ class Baro : public I2C
     void init();
     
     void measure();
-
+    void compensate(unsigned int, unsigned long);
+    void setCalibration(const int *);
+    
     float getAltitude();
     float getGroundAltitude();
     float getRawAltitude();
-
+    
     short getTemp();
     long getPressure();
     
     void setGroundAltitude();
   private:
+    byte _state;
+    unsigned long _requestTime; // When the conversion we're waiting on was started, in micros
+    
+    void requestUT();
     void readUT(); // Uncompensated temperature
     unsigned int _ut;
+    void requestUP();
     void readUP(); // Uncompensated pressure
     unsigned long _up;
-
+    
     short _temp;
     long _pressure;
-
-    I2C _i2c;
-
+    
     float _altitude;
     float _groundAltitude;
-
+    
     byte _overSamplingSetting;
-
+    
     // Calibration values
     int _ac1;
     int _ac2; 
@@ -20,33 +20,72 @@
 #include "WProgram.h"
 #include "Definitions.h"
 #include "Battery.h"
+#include <avr/interrupt.h>
+
+//
+// analogRead() sits and waits ~110us for every conversion. Instead, the ADC is left running on its own, started
+// by every timer 0 overflow (~976Hz, which the Arduino core is already running for millis()), and the conversion
+// complete interrupt adds them up. measure() only has to look at the total.
+//
+// Truly free running would be ~9600 interrupts a second, which is a lot of CPU to spend on a battery.
+//
+
+static volatile unsigned long adcSum; // Running total for the samples so far
+static volatile byte adcCount;
+static volatile unsigned long adcTotal; // The last full set of BATTERY_SAMPLES
+static volatile boolean adcReady; // Is adcTotal new since measure() last looked?
+
+ISR(ADC_vect){
+  adcSum += ADC;
+  
+  if (++adcCount == BATTERY_SAMPLES){
+    adcTotal = adcSum;
+    adcReady = true;
+    adcSum = 0;
+    adcCount = 0;
+  }
+}
 
 Battery::Battery(){
-  _batteryScaleFactor = ((BATTERY_AREF / 1024.0) * ((BATTERY_R1 + BATTERY_R2) / BATTERY_R2));
+  _batteryScaleFactor = ((BATTERY_AREF / 1024.0) * ((BATTERY_R1 + BATTERY_R2) / BATTERY_R2)) / BATTERY_SAMPLES;
+  _batteryVoltage = 0;
 }
 
 void Battery::init(){
-  analogReference(DEFAULT);
-  _alarmTime = millis();
   _alarmLight = 0;
+  
+  // AVcc as the reference (aka DEFAULT), and our pin
+  ADMUX = _BV(REFS0) | (BATTERY_PIN & 0x07);
+  
+  // Convert on timer 0 overflow
+  ADCSRB = _BV(ADTS2) | ((BATTERY_PIN & 0x08) ? _BV(MUX5) : 0);
+  
+  // On, auto triggered, with an interrupt, and the /128 prescaler (125kHz ADC clock)
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
 }
 
+// Cheap: the interrupt has done all of the work. We only do any math when there's a new average
 void Battery::measure(){
-  long currentTime = micros();
-  _batteryVoltage = (analogRead(BATTERY_PIN) * _batteryScaleFactor) + BATTERY_DIODE;
+  if (!adcReady) return;
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long total = adcTotal;
+  adcReady = false;
+  SREG = oldSREG;
   
-  if (_batteryVoltage <= ALARM_VOLTAGE){
-    if (currentTime > _alarmTime){
-      currentTime = _alarmTime + ALARM_RATE;
-      if (_alarmLight == 1){
-        digitalWrite(RED_LED, LOW);
-        _alarmLight = 0;
-      }
-      else{
-        digitalWrite(RED_LED, HIGH);
-        _alarmLight = 1;
-      }
-    }
+  _batteryVoltage = (total * _batteryScaleFactor) + BATTERY_DIODE;
+}
+
+// Blink the alarm light when we are low. Call this every ALARM_RATE
+void Battery::updateAlarm(){
+  if (_batteryVoltage <= ALARM_VOLTAGE && _alarmLight == 0){
+    digitalWrite(RED_LED, HIGH);
+    _alarmLight = 1;
+  }
+  else if (_alarmLight == 1){
+    digitalWrite(RED_LED, LOW);
+    _alarmLight = 0;
   }
 }
 
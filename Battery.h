@@ -29,6 +29,7 @@ class Battery
     void init();
 
     void measure();
+    void updateAlarm();
 
     float getData();
     
@@ -36,7 +37,6 @@ class Battery
     float _batteryScaleFactor;
     float _batteryVoltage;
     
-    long _alarmTime;
     byte _alarmLight;
 };
 
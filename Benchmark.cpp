@@ -0,0 +1,318 @@
+/*
+  Benchmark.cpp - Microbenchmarks for the flight code's hot kernels
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Each kernel runs against the same fixed inputs every time, so its number only moves when the code does. The
+// inputs live in flash and are copied out before each call, outside the timing, along with anything else a call
+// needs (findMedian() sorts in place, so it gets a fresh copy every time). The objects are made fresh for each run.
+//
+// On the board each call is timed on its own: interrupts off, timer 1 counting every cycle, and the cost of an
+// empty call taken off. Timer 1 is the PWM receiver's clock, so it's put back afterwards, moved on by however long
+// we took. That's only good enough while disarmed (see the 'm' and 'n' serial commands). benchmarkTime() times one
+// call of anything else the same way.
+//
+// Anywhere else one call is too quick for the clock, so each kernel runs as one big batch, less a batch that only
+// copies the inputs.
+//
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "Benchmark.h"
+#include "Utils.h"
+#include "IMU.h"
+#include "PID.h"
+#include "Baro.h"
+#include "Mag.h"
+#include "Accel.h"
+
+#include <avr/pgmspace.h>
+
+#if !defined(__AVR__)
+#include <time.h>
+#endif
+
+#define BENCHMARK_INPUTS 8
+#define BENCHMARK_SAMPLES ZERO_SAMPLES // As many as autoZero() takes the median of
+#define BENCHMARK_WARMUP 8 // Untimed calls before the timed ones, 1 for every this many
+
+struct BenchmarkInput {
+  float gyro[3]; // Roll, pitch, yaw rates in degrees/s
+  float angle[3]; // Accel angles in degrees, as imu.update() gets them
+  float heading; // Compass heading in degrees
+  float accel[3]; // Smoothed accel X, Y, Z in Gs
+  int mag[3]; // Raw mag X, Y, Z
+  unsigned int ut; // Raw baro temperature
+  unsigned long up; // Raw baro pressure, at the highest oversampling
+};
+
+// Around a hover, and across the compass wrap at north
+static const BenchmarkInput benchmarkInputs[BENCHMARK_INPUTS] PROGMEM = {
+  {{0.5, -1.2, 0.3}, {1.1, -0.4, 88.9}, 358.5, {-0.007, 0.019, 0.999}, {207, 3, 512}, 27898, 190744},
+  {{12.4, 3.1, -2.2}, {2.5, 0.3, 87.4}, 359.6, {0.005, 0.044, 0.998}, {205, -6, 511}, 27901, 190712},
+  {{-8.7, 6.6, 1.5}, {-1.8, 1.9, 87.9}, 0.8, {0.033, -0.031, 0.998}, {211, 9, 509}, 27895, 190781},
+  {{-20.3, -4.4, 5.9}, {-4.2, -1.1, 85.6}, 2.1, {-0.019, -0.073, 0.996}, {199, 14, 514}, 27899, 190690},
+  {{3.3, -15.8, -0.6}, {0.6, -3.7, 86.2}, 1.4, {-0.065, 0.010, 0.997}, {226, -2, 505}, 27904, 190753},
+  {{1.9, 9.2, -7.1}, {0.2, 2.2, 87.7}, 0.2, {0.038, 0.003, 0.999}, {189, 5, 517}, 27893, 190729},
+  {{-0.4, 0.8, 12.0}, {-0.1, 0.1, 89.8}, 359.1, {0.002, -0.002, 1.001}, {210, -17, 510}, 27897, 190768},
+  {{6.2, -2.7, -11.4}, {1.4, -0.6, 88.4}, 357.7, {-0.010, 0.024, 1.000}, {204, 22, 513}, 27900, 190705},
+};
+
+// Gyro-sized noise
+static const int benchmarkSamples[BENCHMARK_SAMPLES] PROGMEM = {
+  4, -18, 13, -31, -28, 31, -25, 9, 37, -30,
+  27, -10, -33, -26, 18, 16, -29, -7, -26, 33,
+  17, -30, 35, -22, -9, 43, 43, 37, -30, 36,
+  37, 13, -31, -9, -32, 34, -20, 0, 16, -19,
+  32, -22, 36, 2, 34, -14, -24, 37, 36, -13,
+};
+
+// From the BMP085 datasheet's worked example
+static const int benchmarkBaroCalibration[BARO_CALIBRATION_WORDS] PROGMEM = {
+  408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868
+};
+
+static const char benchmarkNames[BENCHMARK_COUNT][BENCHMARK_NAME_LENGTH] PROGMEM = {
+  "filterSmooth",
+  "findMedian",
+  "IMU::update",
+  "PID::updatePID",
+  "Baro::compensate",
+  "Mag::compensate",
+  "Accel::angles",
+};
+
+// Everything a run needs, on the stack for as long as it lasts
+struct BenchmarkScratch {
+  BenchmarkInput input;
+  int samples[BENCHMARK_SAMPLES];
+  float smoothed;
+  
+  IMU imu;
+  PID pid;
+  Baro baro;
+  Mag mag;
+  Accel accel;
+};
+
+typedef void (*BenchmarkKernel)(BenchmarkScratch &);
+
+// Results go here, so the compiler can't throw the work away
+static volatile float benchmarkSink;
+
+///////////
+
+static void runNothing(BenchmarkScratch &s){
+}
+
+static void runFilterSmooth(BenchmarkScratch &s){
+  s.smoothed = filterSmooth(s.input.accel[ZAXIS], s.smoothed, 0.8);
+}
+
+static void runMedian(BenchmarkScratch &s){
+  benchmarkSink = findMedian(s.samples, BENCHMARK_SAMPLES);
+}
+
+static void runIMU(BenchmarkScratch &s){
+  s.imu.update(10, s.input.gyro[ROLL], s.input.gyro[PITCH], s.input.gyro[YAW], s.input.angle[ROLL], s.input.angle[PITCH], s.input.angle[YAW], s.input.heading);
+}
+
+static void runPID(BenchmarkScratch &s){
+  benchmarkSink = s.pid.updatePID(0, s.input.angle[ROLL], 0.01);
+}
+
+static void runBaro(BenchmarkScratch &s){
+  s.baro.compensate(s.input.ut, s.input.up);
+  benchmarkSink = s.baro.getRawAltitude();
+}
+
+static void runMag(BenchmarkScratch &s){
+  s.mag.compensate(s.input.mag[XAXIS], s.input.mag[YAXIS], s.input.mag[ZAXIS], s.input.angle[ROLL], s.input.angle[PITCH]);
+  benchmarkSink = s.mag.getHeadingDegrees();
+}
+
+// All three, like every loop does
+static void runAccelAngles(BenchmarkScratch &s){
+  benchmarkSink = s.accel.getXAngle() + s.accel.getYAngle() + s.accel.getZAngle();
+}
+
+static BenchmarkKernel benchmarkKernel(byte kernel){
+  switch (kernel){
+    case BENCHMARK_FILTER_SMOOTH: return runFilterSmooth;
+    case BENCHMARK_MEDIAN: return runMedian;
+    case BENCHMARK_IMU: return runIMU;
+    case BENCHMARK_PID: return runPID;
+    case BENCHMARK_BARO: return runBaro;
+    case BENCHMARK_MAG: return runMag;
+    case BENCHMARK_ACCEL_ANGLES: return runAccelAngles;
+  }
+  
+  return runNothing;
+}
+
+// Inputs for the call'th call
+static void benchmarkPrepare(BenchmarkScratch &s, byte kernel, unsigned long call){
+  memcpy_P(&s.input, &benchmarkInputs[call % BENCHMARK_INPUTS], sizeof(s.input));
+  
+  if (kernel == BENCHMARK_MEDIAN) memcpy_P(s.samples, benchmarkSamples, sizeof(s.samples));
+  if (kernel == BENCHMARK_ACCEL_ANGLES) s.accel.setSmoothed(s.input.accel[XAXIS], s.input.accel[YAXIS], s.input.accel[ZAXIS]);
+}
+
+#if defined(__AVR__)
+
+struct BenchmarkTimer {
+  byte sreg;
+  byte modeA;
+  byte modeB;
+  uint16_t before;
+};
+
+// Timer 1 to ourselves, with no prescaler
+static void benchmarkStart(BenchmarkTimer &timer){
+  timer.sreg = SREG;
+  cli();
+  
+  timer.modeA = TCCR1A;
+  timer.modeB = TCCR1B;
+  timer.before = TCNT1;
+  
+  TCCR1B = 0;
+  TCCR1A = 0;
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TCCR1B = _BV(CS10);
+}
+
+// Returns the cycles since benchmarkStart()
+static unsigned long benchmarkStop(BenchmarkTimer &timer){
+  TCCR1B = 0;
+  unsigned long cycles = TCNT1;
+  if (TIFR1 & _BV(TOV1)) cycles += 65536; // Good for one overflow, so calls up to 8ms
+  
+  // And back, as if it had been counting at 2 ticks per microsecond the whole time
+  TCNT1 = timer.before + cycles / 8;
+  TCCR1A = timer.modeA;
+  TCCR1B = timer.modeB;
+  
+  SREG = timer.sreg;
+  return cycles;
+}
+
+// How many cycles one call takes
+static unsigned long benchmarkCall(BenchmarkKernel run, BenchmarkScratch &s){
+  BenchmarkTimer timer;
+  benchmarkStart(timer);
+  run(s);
+  return benchmarkStop(timer);
+}
+
+#else
+
+// Monotonic nanoseconds
+static unsigned long long benchmarkNow(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+///////////
+
+// Copies the kernel's name, up to BENCHMARK_NAME_LENGTH bytes with the null
+void benchmarkName(byte kernel, char *name){
+  if (kernel >= BENCHMARK_COUNT){
+    name[0] = 0;
+    return;
+  }
+  
+  memcpy_P(name, benchmarkNames[kernel], BENCHMARK_NAME_LENGTH);
+}
+
+// Time one call of something that isn't a kernel, like sending a telemetry frame
+// Returns how long it took, in BENCHMARK_UNITs
+unsigned long benchmarkTime(BenchmarkFunction run){
+#if defined(__AVR__)
+  BenchmarkTimer timer;
+  benchmarkStart(timer);
+  unsigned long overhead = benchmarkStop(timer); // Nothing but the timer itself
+  
+  benchmarkStart(timer);
+  run();
+  unsigned long cycles = benchmarkStop(timer);
+  return cycles > overhead ? cycles - overhead : 0;
+#else
+  unsigned long long start = benchmarkNow();
+  run();
+  return benchmarkNow() - start;
+#endif
+}
+
+// Time a kernel over this many calls, after a warm-up
+// Returns the average per call, in BENCHMARK_UNITs
+float benchmarkRun(byte kernel, unsigned long calls){
+  if (kernel >= BENCHMARK_COUNT || !calls) return 0;
+  
+  BenchmarkScratch s;
+  s.smoothed = 0;
+  s.pid.setP(6.1); // The level PIDs' defaults
+  s.pid.setD(0.9);
+  
+  int calibration[BARO_CALIBRATION_WORDS];
+  memcpy_P(calibration, benchmarkBaroCalibration, sizeof(calibration));
+  s.baro.setCalibration(calibration);
+  
+  BenchmarkKernel run = benchmarkKernel(kernel);
+  
+  for (unsigned long call = 0; call < calls / BENCHMARK_WARMUP + 1; call++){
+    benchmarkPrepare(s, kernel, call);
+    run(s);
+  }
+  
+#if defined(__AVR__)
+  unsigned long overhead = 0xFFFFFFFF;
+  for (byte i = 0; i < BENCHMARK_INPUTS; i++){
+    overhead = min(overhead, benchmarkCall(runNothing, s));
+  }
+  
+  unsigned long total = 0;
+  for (unsigned long call = 0; call < calls; call++){
+    benchmarkPrepare(s, kernel, call);
+    total += benchmarkCall(run, s) - overhead;
+  }
+  
+  return (float)total / calls;
+#else
+  unsigned long long start = benchmarkNow();
+  for (unsigned long call = 0; call < calls; call++){
+    benchmarkPrepare(s, kernel, call);
+    run(s);
+  }
+  long long elapsed = benchmarkNow() - start;
+  
+  BenchmarkKernel nothing = benchmarkKernel(BENCHMARK_COUNT);
+  start = benchmarkNow();
+  for (unsigned long call = 0; call < calls; call++){
+    benchmarkPrepare(s, kernel, call);
+    nothing(s);
+  }
+  elapsed -= benchmarkNow() - start;
+  
+  return elapsed > 0 ? (float)elapsed / calls : 0;
+#endif
+}
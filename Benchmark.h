@@ -0,0 +1,51 @@
+/*
+  Benchmark.h - Microbenchmarks for the flight code's hot kernels
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include "WProgram.h"
+
+// Kernel IDs, in the order they run
+#define BENCHMARK_FILTER_SMOOTH 0
+#define BENCHMARK_MEDIAN 1
+#define BENCHMARK_IMU 2
+#define BENCHMARK_PID 3
+#define BENCHMARK_BARO 4
+#define BENCHMARK_MAG 5
+#define BENCHMARK_ACCEL_ANGLES 6
+#define BENCHMARK_COUNT 7
+
+#define BENCHMARK_NAME_LENGTH 20 // Longest name, plus the null
+
+// On the board, cycles counted by timer 1. Anywhere else, wall clock time
+#if defined(__AVR__)
+#define BENCHMARK_UNIT "cycles"
+#define BENCHMARK_CALLS 64
+#else
+#define BENCHMARK_UNIT "ns"
+#define BENCHMARK_CALLS 1000000
+#endif
+
+typedef void (*BenchmarkFunction)();
+
+void benchmarkName(byte kernel, char *name);
+float benchmarkRun(byte kernel, unsigned long calls);
+unsigned long benchmarkTime(BenchmarkFunction run);
+
+#endif
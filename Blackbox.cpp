@@ -0,0 +1,266 @@
+/*
+  Blackbox.cpp - Library for recording flight data into a ring buffer, as compactly as we can
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Frames are a length byte (with BLACKBOX_KEY set for a keyframe), then varints.
+//
+// Keyframes store every field as it is. Everything else starts with a bitmask of which fields changed, and only
+// stores how much those changed since the previous frame. That's usually tiny: zigzag encoded (so small negatives
+// are small too) it's one byte for most fields, and nothing at all for the ones holding still.
+//
+// When the buffer is full, the oldest frames are thrown away. The decoder skips whatever is left of them until it
+// finds a keyframe, which is why there's one every BLACKBOX_KEYFRAME frames.
+//
+// Recording to flash instead, nothing is thrown away: each flight is appended to the log, until it's erased. If
+// the flash can't keep up, frames are dropped and the next one is a keyframe. Each flight starts with a frame's
+// worth of zeros, which the decoder skips. They're there in case the last flight lost power halfway through a
+// frame: whatever is left of it is swallowed by the zeros instead of the next flight's first frame.
+//
+
+#include <string.h>
+#include "Blackbox.h"
+
+static uint8_t writeVarint(uint8_t *out, uint32_t value){
+  uint8_t length = 0;
+  
+  while (value >= 0x80){
+    out[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = value;
+  
+  return length;
+}
+
+Blackbox::Blackbox(uint8_t *buffer, uint16_t size){
+  _log = 0;
+  _buffer = buffer;
+  _size = size;
+  
+  erase();
+  _frozen = true; // Nothing to record until someone starts us
+  _frames = 0;
+}
+
+Blackbox::Blackbox(FlashLog *log){
+  _log = log;
+  _buffer = 0;
+  _size = 0;
+  
+  _frozen = true;
+  _frames = 0;
+}
+
+// Start recording. In RAM, that throws away what we had. On flash, it starts a new flight at the end of the log
+void Blackbox::start(){
+  if (_log){
+    if (_log->getLength()){
+      uint8_t padding[BLACKBOX_MAX_FRAME];
+      memset(padding, 0, sizeof(padding));
+      _log->write(padding, sizeof(padding));
+    }
+  }
+  else{
+    erase();
+  }
+  
+  _sinceKey = 0;
+  _frames = 0;
+  _frozen = false;
+  
+  memset(_last, 0, sizeof(_last));
+}
+
+// Stop recording and keep what we have, so it can be dumped
+void Blackbox::freeze(){
+  _frozen = true;
+  if (_log) _log->flush();
+}
+
+bool Blackbox::isFrozen(){
+  return _frozen;
+}
+
+// Throw away everything recorded. On flash that takes a while, see FlashLog::erase()
+void Blackbox::erase(){
+  if (_log){
+    _log->erase();
+  }
+  else{
+    _tail = 0;
+    _length = 0;
+  }
+}
+
+void Blackbox::record(const int32_t *fields){
+  if (_frozen) return;
+  
+  uint8_t frame[BLACKBOX_MAX_FRAME];
+  uint8_t length = encode(fields, frame);
+  
+  if (_log){
+    if (!_log->write(frame, length)) _sinceKey = BLACKBOX_KEYFRAME - 1; // Lost, so the next one can't be a change
+  }
+  else{
+    store(frame, length);
+  }
+  
+  if (++_sinceKey == BLACKBOX_KEYFRAME) _sinceKey = 0;
+  _frames++;
+}
+
+// Returns how many bytes of frame there are
+uint8_t Blackbox::encode(const int32_t *fields, uint8_t *frame){
+  uint8_t length = 1;
+  bool key = _sinceKey == 0;
+  
+  uint8_t *mask = frame + 1;
+  if (!key){
+    memset(mask, 0, BLACKBOX_MASK_BYTES);
+    length += BLACKBOX_MASK_BYTES;
+  }
+  
+  for (uint8_t i=0; i<BLACKBOX_FIELDS; i++){
+    int32_t value = key ? fields[i] : fields[i] - _last[i];
+    _last[i] = fields[i];
+    
+    if (!key){
+      if (value == 0) continue;
+      mask[i >> 3] |= 1 << (i & 7);
+    }
+    
+    length += writeVarint(frame + length, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+  }
+  frame[0] = (length - 1) | (key ? BLACKBOX_KEY : 0);
+  
+  return length;
+}
+
+// Add a frame to the RAM buffer
+void Blackbox::store(const uint8_t *frame, uint8_t length){
+  // Make room by dropping the oldest frames
+  while (_size - _length < length){
+    uint8_t oldest = (_buffer[_tail] & ~BLACKBOX_KEY) + 1;
+    _tail = (_tail + oldest) % _size;
+    _length -= oldest;
+  }
+  
+  uint16_t head = (_tail + _length) % _size;
+  for (uint8_t i=0; i<length; i++){
+    _buffer[head] = frame[i];
+    if (++head == _size) head = 0;
+  }
+  _length += length;
+}
+
+// How many bytes there are to dump
+uint32_t Blackbox::getLength(){
+  return _log ? _log->getLength() : _length;
+}
+
+// Copy out some of the dump, counting from the oldest byte
+// Returns false if it can't be read right now (flash that's still busy), try again later
+bool Blackbox::read(uint32_t offset, uint8_t *data, uint16_t length){
+  if (_log) return _log->read(offset, data, length);
+  
+  for (uint16_t i=0; i<length; i++){
+    data[i] = _buffer[(_tail + offset + i) % _size];
+  }
+  
+  return true;
+}
+
+// Recorded since start(), including any that have since been thrown away
+unsigned long Blackbox::getFrames(){
+  return _frames;
+}
+
+///////////
+
+BlackboxDecoder::BlackboxDecoder(){
+  _index = 0;
+  _length = 0;
+  _haveKey = false;
+  _skipped = 0;
+  
+  memset(_fields, 0, sizeof(_fields));
+}
+
+// Feed in one byte of a dump
+// Returns true if that completed a frame
+bool BlackboxDecoder::push(uint8_t b){
+  if (_index == 0 && b == 0){
+    _haveKey = false; // Padding between flights, see Blackbox::start()
+    return false;
+  }
+  
+  _frame[_index++] = b;
+  if (_index == 1){
+    _length = b & ~BLACKBOX_KEY;
+    if (_length > BLACKBOX_MAX_FRAME - 1) _length = BLACKBOX_MAX_FRAME - 1; // Garbage, but don't overrun
+    if (_length) return false;
+  }
+  if (_index < _length + 1) return false;
+  
+  _index = 0;
+  bool key = _frame[0] & BLACKBOX_KEY;
+  if (!key && !_haveKey){
+    _skipped++;
+    return false;
+  }
+  _haveKey = true;
+  
+  const uint8_t *mask = _frame + 1;
+  uint8_t offset = key ? 1 : 1 + BLACKBOX_MASK_BYTES;
+  
+  for (uint8_t i=0; i<BLACKBOX_FIELDS; i++){
+    if (!key && !(mask[i >> 3] & (1 << (i & 7)))) continue; // Didn't change
+    
+    uint32_t raw = 0;
+    uint8_t shift = 0;
+    
+    while (offset <= _length){
+      uint8_t data = _frame[offset++];
+      raw |= (uint32_t)(data & 0x7F) << shift;
+      shift += 7;
+      if (!(data & 0x80)) break;
+    }
+    
+    int32_t value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+    _fields[i] = key ? value : _fields[i] + value;
+  }
+  
+  // The fields should have used up the frame exactly. If not, it's the remains of a frame that was cut short
+  if (offset != _length + 1){
+    _haveKey = false;
+    _skipped++;
+    return false;
+  }
+  
+  return true;
+}
+
+int32_t BlackboxDecoder::getField(uint8_t field){
+  return _fields[field];
+}
+
+// Frames we couldn't decode because their keyframe had been thrown away, or they didn't make sense
+unsigned long BlackboxDecoder::getSkipped(){
+  return _skipped;
+}
@@ -0,0 +1,107 @@
+/*
+  Blackbox.h - Library for recording flight data into a ring buffer, as compactly as we can
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Blackbox_h
+#define Blackbox_h
+
+// No Arduino dependencies in here, so that the host tools can decode a dump with the same code
+#include <stdint.h>
+#include "FlashLog.h"
+
+//
+// What's in each frame, in order
+//
+#define BLACKBOX_DELTA_TIME 0 // Microseconds since the last frame
+#define BLACKBOX_ROLL 1 // Hundredths of a degree
+#define BLACKBOX_PITCH 2
+#define BLACKBOX_HEADING 3
+#define BLACKBOX_TARGET_ROLL 4
+#define BLACKBOX_TARGET_PITCH 5
+#define BLACKBOX_TARGET_HEADING 6
+#define BLACKBOX_GYRO_ROLL 7 // Hundredths of a degree/second
+#define BLACKBOX_GYRO_PITCH 8
+#define BLACKBOX_GYRO_YAW 9
+#define BLACKBOX_ROLL_ADJUST 10 // PID outputs, tenths of a motor unit
+#define BLACKBOX_PITCH_ADJUST 11
+#define BLACKBOX_HEADING_ADJUST 12
+#define BLACKBOX_THROTTLE 13
+#define BLACKBOX_MOTORS 14 // 6 of them, unused ones are 0
+#define BLACKBOX_FIELDS 20
+
+#define BLACKBOX_KEYFRAME 32 // Every this many frames, store whole values instead of changes
+#define BLACKBOX_MASK_BYTES ((BLACKBOX_FIELDS + 7) / 8)
+#define BLACKBOX_MAX_FRAME (1 + BLACKBOX_MASK_BYTES + BLACKBOX_FIELDS * 5) // Length byte, mask, and the longest varints
+
+#define BLACKBOX_KEY 0x80 // Set in a frame's length byte if it's a keyframe
+
+class Blackbox
+{
+  public:
+    Blackbox(uint8_t *buffer, uint16_t size);
+    Blackbox(FlashLog *log);
+    
+    void start();
+    void freeze();
+    bool isFrozen();
+    void erase();
+    
+    void record(const int32_t *fields);
+    
+    uint32_t getLength();
+    bool read(uint32_t offset, uint8_t *data, uint16_t length);
+    unsigned long getFrames();
+    
+  private:
+    FlashLog *_log; // If we're recording to flash instead of _buffer
+    
+    uint8_t *_buffer;
+    uint16_t _size;
+    uint16_t _tail; // Oldest frame
+    uint16_t _length; // Bytes in use
+    
+    int32_t _last[BLACKBOX_FIELDS]; // Last frame, to take the changes from
+    uint8_t _sinceKey; // Frames since the last keyframe
+    
+    bool _frozen;
+    unsigned long _frames;
+    
+    uint8_t encode(const int32_t *fields, uint8_t *frame);
+    void store(const uint8_t *frame, uint8_t length);
+};
+
+class BlackboxDecoder
+{
+  public:
+    BlackboxDecoder();
+    
+    bool push(uint8_t);
+    
+    int32_t getField(uint8_t);
+    unsigned long getSkipped();
+    
+  private:
+    uint8_t _frame[BLACKBOX_MAX_FRAME];
+    uint8_t _index;
+    uint8_t _length;
+    bool _haveKey; // Changes are meaningless until we've seen a keyframe
+    
+    int32_t _fields[BLACKBOX_FIELDS];
+    unsigned long _skipped;
+};
+
+#endif
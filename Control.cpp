@@ -0,0 +1,49 @@
+/*
+  Control.cpp - The attitude control step, shared by the flight code and the host tools that fly it
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// processFlightControl() calls these once per loop while armed, and so does host/pidsweep.cpp for each of its
+// simulated flights, so that what gets tuned there is exactly what flies.
+//
+
+#include "Control.h"
+
+// Are we beyond saving?
+boolean controlPanic(float roll, float pitch){
+  return roll > CONTROL_PANIC_ANGLE || roll < -CONTROL_PANIC_ANGLE || pitch > CONTROL_PANIC_ANGLE || pitch < -CONTROL_PANIC_ANGLE;
+}
+
+// Work out the roll, pitch and heading adjustments for the mixer from where we are and where we want to be
+// target, current and adjust are indexed by ROLL, PITCH and YAW. dT is in seconds
+void controlAttitude(PID *rollPID, PID *pitchPID, PID *headingPID, const float *target, const float *current, float dT, float *adjust){
+  // Negative values mean the right side is up
+  // Constrained, because beyond that, we're fucked anyway
+  adjust[ROLL] = rollPID->updatePID(target[ROLL], constrain(current[ROLL], -CONTROL_MAX_ANGLE, CONTROL_MAX_ANGLE), dT);
+  
+  // Positive values mean the frontend is up
+  // Constrained, because beyond that, we're fucked anyway
+  adjust[PITCH] = pitchPID->updatePID(target[PITCH], constrain(current[PITCH], -CONTROL_MAX_ANGLE, CONTROL_MAX_ANGLE), dT);
+  
+  // Positive values are to the right
+  // The short way round, so that being just past north isn't a 359 degree error
+  float headingError = target[YAW] - current[YAW];
+  if (headingError > 180) headingError -= 360;
+  else if (headingError < -180) headingError += 360;
+  adjust[YAW] = headingPID->updatePID(current[YAW] + headingError, current[YAW], dT);
+}
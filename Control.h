@@ -0,0 +1,32 @@
+/*
+  Control.h - The attitude control step, shared by the flight code and the host tools that fly it
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Control_h
+#define Control_h
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "PID.h"
+
+#define CONTROL_PANIC_ANGLE 90 // Past this much roll or pitch, the engines are cut
+#define CONTROL_MAX_ANGLE 50 // The most roll or pitch the level PIDs are shown, either way
+
+boolean controlPanic(float, float);
+void controlAttitude(PID *, PID *, PID *, const float *, const float *, float, float *);
+
+#endif
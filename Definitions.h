@@ -20,20 +20,45 @@
 */
 
 // Global definitions
+
+// Frame layout. See the mix tables in Mixer.cpp for which engine is where
+#define FRAME_X 0
+#define FRAME_PLUS 1
+#define FRAME_HEX 2 // Hex-X: flat side forward
+#define FRAME_TYPE FRAME_X
+
+#if FRAME_TYPE == FRAME_HEX
+#define ENGINE_COUNT 6
+#else
 #define ENGINE_COUNT 4
+#endif
+
 // Speeds are in microseconds, not degrees, for greater control
 #define MIN_MOTOR_SPEED 1000
 #define MAX_MOTOR_SPEED 2000
 
-#define LEFT_FRONT_MOTOR_PIN 9
-#define RIGHT_FRONT_MOTOR_PIN 10
-#define LEFT_REAR_MOTOR_PIN 3
-#define RIGHT_REAR_MOTOR_PIN 11
+// ESCs are driven straight from the Mega's 16-bit timers 3 and 4, so these pins can't move
+// without also changing the registers in Engines.cpp
+#define LEFT_FRONT_MOTOR_PIN 2 // OC3B
+#define RIGHT_FRONT_MOTOR_PIN 3 // OC3C
+#define LEFT_REAR_MOTOR_PIN 5 // OC3A
+#define RIGHT_REAR_MOTOR_PIN 6 // OC4A
+#define LEFT_MIDDLE_MOTOR_PIN 7 // OC4B, hex only
+#define RIGHT_MIDDLE_MOTOR_PIN 8 // OC4C, hex only
+
+// How we talk to the ESCs
+#define ESC_PWM 0 // Standard 1000-2000us servo pulses, ESC_UPDATE_RATE times a second
+#define ESC_ONESHOT125 1 // 125-250us pulses, fired once per control loop. Your ESCs have to support it!
+#define ESC_PROTOCOL ESC_PWM
+
+#define ESC_UPDATE_RATE 400 // How many pulses per second the ESCs get in PWM mode, in Hz. Standard servo rate is 50
 
 #define LEFT_FRONT_MOTOR 0
 #define RIGHT_FRONT_MOTOR  1
 #define LEFT_REAR_MOTOR 2
 #define RIGHT_REAR_MOTOR 3
+#define LEFT_MIDDLE_MOTOR 4
+#define RIGHT_MIDDLE_MOTOR 5
 
 #define GYRO_ADDR 0x68
 #define ACCEL_ADDR 0x53
@@ -51,6 +76,10 @@
 #define VERSION 2.3 // Emulate Aeroquad
 
 #define SERIAL_RATE 1000 // How long between running the serial code, in microseconds?
+#define SERIAL_TX_BUDGET 160 // Most bytes of telemetry we'll queue per loop. 115200 baud is ~11.5 bytes/ms
+#define SERIAL_TX_MIN_BUDGET 96 // Any less and the longest reply line ('P', up to 92 bytes) could never go out
+#define SERIAL_STREAMS 4 // How many telemetry streams can be subscribed to at once
+#define SERIAL_COMMAND_TIMEOUT 50 // Drop a half-received command if nothing more arrives for this long, in milliseconds
 
 // Activity
 #define RED_LED 31 // Battery alarm
@@ -69,6 +98,15 @@
 #define MIN_ACCEL_YAW 510
 
 // Receiver
+#define RECEIVER_PWM 0 // One wire per channel, on A8-A13
+#define RECEIVER_PPM 1 // PPM-sum, all channels on RECEIVER_PPM_PIN
+#define RECEIVER_SBUS 2 // S.BUS style serial on RECEIVER_SERIAL (through an inverter!)
+#define RECEIVER_TYPE RECEIVER_PWM
+
+#define RECEIVER_PPM_PIN 48 // ICP5, has to be a timer 5 input capture pin
+#define RECEIVER_SERIAL Serial1 // RX1 is pin 19
+#define RECEIVER_SERIAL_UCSRC UCSR1C // Has to match RECEIVER_SERIAL
+
 #define CHANNELS 6
 #define THROTTLE_CHANNEL 0
 #define YAW_CHANNEL 1
@@ -76,6 +114,11 @@
 #define ROLL_CHANNEL 3
 #define GEAR_CHANNEL 4
 #define AUX_CHANNEL 5
+#define RECEIVER_MIN_PULSE 750 // Shortest believable pulse, in microseconds
+#define RECEIVER_MAX_PULSE 2250 // Longest believable pulse, in microseconds
+#define RECEIVER_MAX_ANGLE 45.0 // Full stick at a rate of 1.0, in degrees
+#define RECEIVER_FAILSAFE_TIMEOUT 500 // How long without a good frame before we give up on the transmitter, in milliseconds
+#define FAILSAFE_THROTTLE_RATE 100.0 // How fast to throttle down once we have, in motor units per second
 
 // Battery monitor
 #define BATTERY_PIN 0 // This is the same on every arduino
@@ -83,4 +126,27 @@
 #define BATTERY_R2 7390.0 // 7.5k resistor measured with a multimeter, must be a float!
 #define BATTERY_AREF 5.0 // Arduino Mega runs at 5v
 #define BATTERY_DIODE 0.9 // On-board diode, measured with a multimeter
+#define BATTERY_SAMPLES 64 // ADC readings to average together, at ~1kHz
 #define ALARM_VOLTAGE 9.0
+
+// Battery compensation: as the pack sags, scale engine speeds up by nominal/measured so thrust stays the same
+#define BATTERY_COMPENSATION 1 // 0 to turn it off
+#define BATTERY_NOMINAL_VOLTAGE 11.1 // The voltage the PIDs were tuned at
+#define BATTERY_COMP_MIN_VOLTAGE 7.0 // Below this we're not measuring a real battery, so ignore it
+#define BATTERY_COMP_SMOOTH 0.02 // Smoothing for the voltage we compensate for
+#define BATTERY_COMP_RATE 0.05 // How fast the compensation may change, per second
+#define BATTERY_COMP_MIN 0.9 // Limits on the compensation itself
+#define BATTERY_COMP_MAX 1.3
+
+// Blackbox
+#define BLACKBOX_FLASH 0 // 1 to record to an SPI flash chip instead of RAM
+#define BLACKBOX_SIZE 3072 // Bytes of RAM to record flight data into. ~18 bytes a frame, one frame per loop
+#define FLASH_CS_PIN 53 // Chip select for the flash. The rest is the hardware SPI pins: 50 MISO, 51 MOSI, 52 SCK
+
+// Autotune
+#define AUTOTUNE_RELAY 100.0 // How hard to push the axis each way, in motor units
+#define AUTOTUNE_HYSTERESIS 1.0 // Noise band around the target, in degrees
+#define AUTOTUNE_SKIP_CYCLES 2 // Oscillations to let settle before measuring
+#define AUTOTUNE_CYCLES 6 // Oscillations to average over
+#define AUTOTUNE_MAX_ANGLE 30.0 // Give up if we tip further than this, in degrees
+#define AUTOTUNE_TIMEOUT 30000000 // Give up if an axis takes longer than this, in microseconds
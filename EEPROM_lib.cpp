@@ -20,7 +20,40 @@
 #include "WProgram.h"
 #include "Definitions.h"
 #include <EEPROM.h>
+#include <stddef.h>
 #include "EEPROM_lib.h"
+#include "Telemetry.h"
+#include <avr/interrupt.h>
+
+Config config; // The RAM copy of what's in eeprom
+
+// What the interrupt is writing out: a copy, so config can keep changing underneath it
+static Config eepromImage;
+static volatile unsigned int eepromIndex = sizeof(Config); // Next byte of eepromImage to check
+static volatile boolean eepromWriting = false;
+
+// The last write has finished. Find the next byte that's different and start writing it
+// Each write takes ~3.3ms, so that's ~3.3ms between interrupts, and the loop never waits on any of them
+ISR(EE_READY_vect){
+  const byte *image = (const byte *)&eepromImage;
+  
+  while (eepromIndex < sizeof(Config)){
+    EEAR = EEPROM_ADDR_CONFIG + eepromIndex;
+    EECR |= _BV(EERE);
+    byte current = EEDR;
+    byte value = image[eepromIndex++];
+    
+    if (current != value){
+      EEDR = value;
+      EECR |= _BV(EEMPE);
+      EECR |= _BV(EEPE);
+      return;
+    }
+  }
+  
+  EECR &= ~_BV(EERIE); // All done
+  eepromWriting = false;
+}
 
 ////////////
 
@@ -100,10 +133,72 @@ void eeprom_write(int address, int value){
 
 //////////////
 
-// Write everything we care about to eeprom
+// Same CRC-16 as the telemetry frames
+static uint16_t configCRC(){
+  const byte *image = (const byte *)&config;
+  uint16_t crc = 0xFFFF;
+  
+  for (unsigned int i=0; i<offsetof(Config, crc); i++){
+    crc = telemetryCRC(crc, image[i]);
+  }
+  
+  return crc;
+}
+
+// What we use when there's nothing good in eeprom. Everything else falls back on its own defaults from here
+void eeprom_defaults(){
+  memset(&config, 0, sizeof(config));
+  
+  for (byte id = 0; id < PARAM_COUNT; id++){
+    config.parameters[id] = NAN;
+  }
+}
+
+// Write everything we care about to eeprom, in the background
+// Each byte write takes ~3.3ms and wears the cell out a little, so only the bytes that changed are written
+// Calling this again before it's done just starts over with the newer config
 void eeprom_write_all(){
+  config.version = CONFIG_VERSION;
+  config.length = sizeof(config);
+  config.crc = configCRC();
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  
+  eepromImage = config;
+  eepromIndex = 0;
+  eepromWriting = true;
+  EECR |= _BV(EERIE); // Fires as soon as the eeprom isn't busy
+  
+  SREG = oldSREG;
+}
+
+// Are we still writing?
+boolean eeprom_busy(){
+  return eepromWriting;
+}
+
+// Bytes of the image that haven't been checked (and maybe written) yet
+int eeprom_pending(){
+  uint8_t oldSREG = SREG;
+  cli();
+  int pending = sizeof(Config) - eepromIndex;
+  SREG = oldSREG;
+  
+  return pending;
 }
 
 // Reload everything we care about from eeprom
-void eeprom_read_all(){
+// If it's blank, from an older version, or corrupt, we get the defaults instead and return false
+boolean eeprom_read_all(){
+  byte *image = (byte *)&config;
+  
+  for (unsigned int i=0; i<sizeof(config); i++){
+    image[i] = eeprom_read(EEPROM_ADDR_CONFIG + i);
+  }
+  
+  if (config.version == CONFIG_VERSION && config.length == sizeof(config) && config.crc == configCRC()) return true;
+  
+  eeprom_defaults();
+  return false;
 }
@@ -21,14 +21,31 @@
 
 #include "WProgram.h"
 #include "Definitions.h"
+#include "Parameters.h"
 
 //
-// Addresses that we use!
+// Everything we keep is in one image, which lives at EEPROM_ADDR_CONFIG and is loaded into config at boot.
+// Change config, then eeprom_write_all() to store it. That returns right away: the bytes are written in the
+// background by the EEPROM ready interrupt, and eeprom_busy() says whether it's done.
 //
+// Bump CONFIG_VERSION whenever Config changes shape, so an old image is thrown away instead of misread.
+//
+
+#define EEPROM_ADDR_CONFIG 0
+#define CONFIG_VERSION 2
+
+struct Config {
+  uint8_t version;
+  uint16_t length; // sizeof(Config), in case someone forgets the version
+  
+  int16_t accelZero[3];
+  int16_t receiverCalibration[CHANNELS][3]; // Min, center, max
+  float parameters[PARAM_COUNT]; // By ID, see Parameters.pde. NaN for "use the default"
+  
+  uint16_t crc; // Over everything before it
+};
 
-#define EEPROM_ADDR_ACCEL_PITCH 0 // int - 2 bytes
-#define EEPROM_ADDR_ACCEL_ROLL 2 // int - 2 bytes
-#define EEPROM_ADDR_ACCEL_YAW 4 // int - 2 bytes
+extern Config config;
 
 byte eeprom_read(int);
 float eeprom_read_float(int);
@@ -37,7 +54,11 @@ void eeprom_write(int, byte);
 void eeprom_write(int, float);
 void eeprom_write(int, int);
 
+void eeprom_defaults();
 void eeprom_write_all();
-void eeprom_read_all();
+boolean eeprom_read_all();
+
+boolean eeprom_busy();
+int eeprom_pending();
 
 #endif
@@ -20,6 +20,53 @@
 #include "WProgram.h"
 #include "Definitions.h"
 #include "Engines.h"
+#include <avr/interrupt.h>
+
+//
+// Rather than analogWrite() (8-bit timers, ~490Hz, and nowhere near a servo pulse), the ESCs are driven
+// from timers 3 and 4 in 16-bit fast PWM mode.
+//
+// PWM: with a prescaler of 8 that's 2 ticks per microsecond, so every microsecond between MIN_MOTOR_SPEED
+// and MAX_MOTOR_SPEED is its own throttle step.
+//
+// OneShot125: the same pulse, divided by 8, with no prescaler (still 2 ticks per step). Instead of waiting
+// for the next frame, commit() restarts the timers so the new pulses go out right away. If nobody commits,
+// the timers wrap every 4ms on their own, which keeps the ESCs fed while disarmed.
+//
+
+#if ESC_PROTOCOL == ESC_ONESHOT125
+#define ESC_TICKS_PER_US (F_CPU / 8000000) // Timer ticks per microsecond of *command*, i.e. per 1/8us of pulse
+#define ESC_TOP 0xFFFF
+#define ESC_CLOCK_3 _BV(CS30)
+#define ESC_CLOCK_4 _BV(CS40)
+#elif ESC_PROTOCOL == ESC_PWM
+#define ESC_TICKS_PER_US (F_CPU / 8000000) // Timer ticks per microsecond of pulse
+#define ESC_TOP (F_CPU / 8 / ESC_UPDATE_RATE) // Timer ticks per ESC frame
+#define ESC_CLOCK_3 _BV(CS31)
+#define ESC_CLOCK_4 _BV(CS41)
+
+#if 1000000 / ESC_UPDATE_RATE <= MAX_MOTOR_SPEED
+#error "ESC_UPDATE_RATE is too high to fit a full MAX_MOTOR_SPEED pulse"
+#endif
+#else
+#error "Unknown ESC_PROTOCOL"
+#endif
+
+// Pulse widths waiting to go out, in timer ticks. Written by commit(), read by the timer interrupt
+static volatile unsigned int escPulses[ENGINE_COUNT];
+static volatile boolean escPending = false;
+
+// Load the compare registers. They are double buffered by the hardware until the next BOTTOM
+static void writePulses(){
+  OCR3B = escPulses[LEFT_FRONT_MOTOR];
+  OCR3C = escPulses[RIGHT_FRONT_MOTOR];
+  OCR3A = escPulses[LEFT_REAR_MOTOR];
+  OCR4A = escPulses[RIGHT_REAR_MOTOR];
+#if ENGINE_COUNT == 6
+  OCR4B = escPulses[LEFT_MIDDLE_MOTOR];
+  OCR4C = escPulses[RIGHT_MIDDLE_MOTOR];
+#endif
+}
 
 Engines::Engines(){  
   // Setup engines
@@ -27,10 +74,50 @@ Engines::Engines(){
   engines[RIGHT_FRONT_MOTOR] = RIGHT_FRONT_MOTOR_PIN;
   engines[LEFT_REAR_MOTOR] = LEFT_REAR_MOTOR_PIN;
   engines[RIGHT_REAR_MOTOR] = RIGHT_REAR_MOTOR_PIN;
+#if ENGINE_COUNT == 6
+  engines[LEFT_MIDDLE_MOTOR] = LEFT_MIDDLE_MOTOR_PIN;
+  engines[RIGHT_MIDDLE_MOTOR] = RIGHT_MIDDLE_MOTOR_PIN;
+#endif
+
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    engine_speeds[engine] = MIN_MOTOR_SPEED;
+  }
 }
 
 void Engines::init(){
-  //allStop();
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    pinMode(engines[engine], OUTPUT);
+  }
+  
+  // Hold the prescaler in reset while we set the timers up, so that they count in lockstep
+  GTCCR = _BV(TSM) | _BV(PSRSYNC);
+  
+  // Fast PWM with ICRn as TOP (mode 14), clear the outputs on compare match
+  TCCR3A = _BV(COM3A1) | _BV(COM3B1) | _BV(COM3C1) | _BV(WGM31);
+  TCCR3B = _BV(WGM33) | _BV(WGM32) | ESC_CLOCK_3;
+  ICR3 = ESC_TOP;
+  
+#if ENGINE_COUNT == 6
+  TCCR4A = _BV(COM4A1) | _BV(COM4B1) | _BV(COM4C1) | _BV(WGM41);
+#else
+  TCCR4A = _BV(COM4A1) | _BV(WGM41);
+#endif
+  TCCR4B = _BV(WGM43) | _BV(WGM42) | ESC_CLOCK_4;
+  ICR4 = ESC_TOP;
+  
+  TCNT3 = 0;
+  TCNT4 = 0;
+  
+  // Idle until someone says otherwise
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    escPulses[engine] = engine_speeds[engine] * ESC_TICKS_PER_US;
+  }
+  writePulses();
+#if ESC_PROTOCOL == ESC_PWM
+  TIMSK3 = _BV(TOIE3);
+#endif
+  
+  GTCCR = 0; // And go
 }
 
 void Engines::allStop(){
@@ -38,16 +125,67 @@ void Engines::allStop(){
   setAllSpeed(0);
 }
 
+// Set the speed for one engine. Nothing goes out until commit()
 void Engines::setEngineSpeed(byte engine, int speed){
   speed = constrain(speed, MIN_MOTOR_SPEED, MAX_MOTOR_SPEED);
   
-  // Analog write supports commands from 0-255 => 0 - 100% duty cycle
-  // Using 125-250 for motor setting 1000-2000
-  analogWrite(engines[engine], speed / 8);
-  
   engine_speeds[engine] = speed;
 }
 
+#if ESC_PROTOCOL == ESC_PWM
+
+// Hand the current engine speeds to the timers. They are all picked up at the start of the next
+// ESC frame, so the engines always change together
+void Engines::commit(){
+  uint8_t oldSREG = SREG;
+  cli();
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    escPulses[engine] = engine_speeds[engine] * ESC_TICKS_PER_US;
+  }
+  escPending = true;
+  SREG = oldSREG;
+}
+
+// Fires at TOP, so these compare values are latched by the hardware at the very next BOTTOM,
+// which both timers hit on the same tick
+ISR(TIMER3_OVF_vect){
+  if (!escPending) return;
+  writePulses();
+  escPending = false;
+}
+
+#else
+
+// Fire the current engine speeds at the ESCs right now, all at once
+void Engines::commit(){
+  // Don't cut off pulses that are still going out, the ESC would read them as a lower throttle
+  // (The host build's timers only move with its clock, which doesn't while we sit here)
+#if defined(__AVR__)
+  while (TCNT3 < MAX_MOTOR_SPEED * ESC_TICKS_PER_US);
+#endif
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  
+  TCCR3B &= ~ESC_CLOCK_3;
+  TCCR4B &= ~ESC_CLOCK_4;
+  
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    escPulses[engine] = engine_speeds[engine] * ESC_TICKS_PER_US;
+  }
+  writePulses();
+  
+  // The next tick wraps to BOTTOM, which loads the new compare values and raises every output
+  TCNT3 = ESC_TOP;
+  TCNT4 = ESC_TOP;
+  TCCR3B |= ESC_CLOCK_3;
+  TCCR4B |= ESC_CLOCK_4;
+  
+  SREG = oldSREG;
+}
+
+#endif
+
 int Engines::getEngineSpeed(byte engine){
   return engine_speeds[engine];
 }
@@ -56,6 +194,7 @@ void Engines::setAllSpeed(int speed){
   for (byte engine = 0; engine < ENGINE_COUNT; engine++){
     setEngineSpeed(engine, speed);
   }
+  commit();
 }
 
 // Increase/decrease throttle. Flight Control takes care of applying this to the engines
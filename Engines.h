@@ -29,6 +29,7 @@ class Engines
     void init();
     void allStop();
     void setEngineSpeed(byte, int);
+    void commit();
     int getEngineSpeed(byte);
     void setAllSpeed(int);
     void setThrottle(int);
@@ -0,0 +1,215 @@
+/*
+  FlashLog.cpp - Library for appending a log to SPI NOR flash without waiting on it
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// The log is appended from address 0 up, and never has gaps, so after a reset the end is the first erased page
+// (found with a binary search) less any trailing 0xFF in the page before it.
+//
+// Nothing here waits on the chip. write() just copies into a ring of page buffers; update(), once per loop, hands
+// the oldest full one to the chip a chunk at a time and then leaves it to program while we fly. Sectors are erased
+// a whole sector ahead of the data, at a moment when the buffers are nearly empty, so the 45ms or so that takes is
+// covered by them. If they all fill up anyway, write() drops what it was given rather than stalling.
+//
+
+#include <string.h>
+#include "FlashLog.h"
+
+FlashLog::FlashLog(FlashChip *chip){
+  _chip = chip;
+  _size = 0;
+  
+  _oldest = 0;
+  _queued = 0;
+  memset(_fill, 0, sizeof(_fill));
+  
+  _writeAddress = 0;
+  _erasedTo = 0;
+  _sending = false;
+  _erasing = false;
+  _dropped = 0;
+}
+
+// Find where we left off. The chip has to be ready to talk to
+void FlashLog::begin(){
+  _size = _chip->getSize();
+  
+  uint32_t low = 0;
+  uint32_t high = _size / FLASH_PAGE_SIZE;
+  while (low < high){
+    uint32_t middle = (low + high) / 2;
+    if (pageErased(middle)) high = middle;
+    else low = middle + 1;
+  }
+  
+  _writeAddress = low * FLASH_PAGE_SIZE;
+  if (low){
+    _chip->read(_writeAddress - FLASH_PAGE_SIZE, _pages[0], FLASH_PAGE_SIZE);
+    uint16_t length = FLASH_PAGE_SIZE;
+    while (length && _pages[0][length - 1] == 0xFF) length--;
+    _writeAddress -= FLASH_PAGE_SIZE - length;
+  }
+  
+  // The rest of the sector we're in was erased along with it
+  _erasedTo = (_writeAddress + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+}
+
+// Call once per loop to keep the chip busy
+void FlashLog::update(){
+  if (!_sending){
+    if (_chip->isBusy()) return;
+    
+    if (_erasing){
+      if (_eraseAddress < _eraseEnd){
+        _chip->eraseSector(_eraseAddress);
+        _eraseAddress += FLASH_SECTOR_SIZE;
+      }
+      else{
+        _erasing = false;
+      }
+      return;
+    }
+    
+    // Keep a sector erased ahead of the data. An erase holds up programming for a good while, so wait until the
+    // buffers are nearly empty, unless we're about to need it
+    if (_erasedTo < _size && _erasedTo < _writeAddress + FLASH_SECTOR_SIZE){
+      bool roomy = _queued == 0 && _fill[_oldest] < FLASH_PAGE_SIZE / 4;
+      if (roomy || _erasedTo < _writeAddress + FLASH_PAGE_SIZE * FLASH_LOG_PAGES){
+        _chip->eraseSector(_erasedTo);
+        _erasedTo += FLASH_SECTOR_SIZE;
+        return;
+      }
+    }
+    
+    // Start on the oldest full page, if its sector is ready
+    if (!_queued || _address[_oldest] + _fill[_oldest] > _erasedTo) return;
+    
+    _chip->beginProgram(_address[_oldest]);
+    _sending = true;
+    _sent = 0;
+  }
+  
+  uint16_t length = _fill[_oldest] - _sent;
+  if (length > FLASH_LOG_CHUNK) length = FLASH_LOG_CHUNK;
+  
+  _chip->program(_pages[_oldest] + _sent, length);
+  _sent += length;
+  if (_sent < _fill[_oldest]) return;
+  
+  _chip->endProgram();
+  _sending = false;
+  _fill[_oldest] = 0;
+  _oldest = (_oldest + 1) % FLASH_LOG_PAGES;
+  _queued--;
+}
+
+// Add data to the end of the log. All of it goes in, or (if we're out of room) none of it does
+// Returns false if it was dropped
+bool FlashLog::write(const uint8_t *data, uint16_t length){
+  uint16_t room = 0;
+  if (_queued < FLASH_LOG_PAGES){
+    room = FLASH_PAGE_SIZE - _writeAddress % FLASH_PAGE_SIZE + (FLASH_LOG_PAGES - 1 - _queued) * FLASH_PAGE_SIZE;
+  }
+  
+  if (_erasing || length > room || _writeAddress + length > _size){
+    _dropped++;
+    return false;
+  }
+  
+  while (length){
+    uint8_t page = (_oldest + _queued) % FLASH_LOG_PAGES;
+    if (_fill[page] == 0) _address[page] = _writeAddress;
+    
+    uint16_t count = FLASH_PAGE_SIZE - _writeAddress % FLASH_PAGE_SIZE;
+    if (count > length) count = length;
+    
+    memcpy(_pages[page] + _fill[page], data, count);
+    _fill[page] += count;
+    _writeAddress += count;
+    data += count;
+    length -= count;
+    
+    if (_writeAddress % FLASH_PAGE_SIZE == 0) _queued++;
+  }
+  
+  return true;
+}
+
+// Program whatever we have of the current page, without waiting for it to fill
+// The rest of the page is still erased, so the next write() carries on from there
+void FlashLog::flush(){
+  if (_queued < FLASH_LOG_PAGES && _fill[(_oldest + _queued) % FLASH_LOG_PAGES]) _queued++;
+}
+
+// Throw the whole log away. This takes a while (one sector per update()), and nothing can be written until it's done
+void FlashLog::erase(){
+  // Already on it. Nothing has been written since, and starting over would lose track of where the old log ended
+  if (_erasing) return;
+  
+  // Anything not already on its way to the chip is thrown away too
+  uint8_t keep = _sending ? 1 : 0;
+  for (uint8_t i = keep; i < FLASH_LOG_PAGES; i++){
+    _fill[(_oldest + i) % FLASH_LOG_PAGES] = 0;
+  }
+  _queued = keep;
+  
+  _erasing = true;
+  _eraseAddress = 0;
+  _eraseEnd = (_writeAddress + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+  
+  _writeAddress = 0;
+  if (_erasedTo < _eraseEnd) _erasedTo = _eraseEnd; // Past the end of the log was already erased
+}
+
+// Everything we were given is on the chip, and the chip is free
+bool FlashLog::isIdle(){
+  return !_sending && !_erasing && !_queued && !_fill[_oldest] && !_chip->isBusy();
+}
+// Read back some of the log. Only works while we're idle
+// Returns false if we weren't
+bool FlashLog::read(uint32_t address, uint8_t *data, uint16_t length){
+  if (!isIdle()) return false;
+  
+  _chip->read(address, data, length);
+  return true;
+}
+
+// How many bytes have been logged
+uint32_t FlashLog::getLength(){
+  return _writeAddress;
+}
+
+// How big the chip is, 0 if there isn't one
+uint32_t FlashLog::getSize(){
+  return _size;
+}
+
+// Writes that didn't fit
+unsigned long FlashLog::getDropped(){
+  return _dropped;
+}
+
+bool FlashLog::pageErased(uint32_t page){
+  _chip->read(page * FLASH_PAGE_SIZE, _pages[0], FLASH_PAGE_SIZE);
+  
+  for (uint16_t i=0; i<FLASH_PAGE_SIZE; i++){
+    if (_pages[0][i] != 0xFF) return false;
+  }
+  
+  return true;
+}
@@ -0,0 +1,97 @@
+/*
+  FlashLog.h - Library for appending a log to SPI NOR flash without waiting on it
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef FlashLog_h
+#define FlashLog_h
+
+// No Arduino dependencies in here, so that the host tools can run the same logging code against an emulated chip
+#include <stdint.h>
+
+#define FLASH_PAGE_SIZE 256 // Most bytes one program operation can write, and they can't cross a page boundary
+#define FLASH_SECTOR_SIZE 4096 // Smallest piece we can erase
+#define FLASH_LOG_CHUNK 64 // Bytes of a page to send to the chip per update(), so no one loop pays for a whole page
+#define FLASH_LOG_PAGES 3 // Pages of RAM to buffer in. Enough to keep logging at ~400 frames a second through an erase
+
+//
+// What FlashLog needs from a chip. SPIFlash talks to a real one, tools/FlashEmulator.h pretends to be one.
+//
+// Programming and erasing only start the operation: the chip is busy until it's done, and anything but isBusy()
+// is ignored until then. A program is beginProgram(), any number of program() calls, then endProgram(), which is
+// when the chip actually starts writing.
+//
+class FlashChip
+{
+  public:
+    virtual uint32_t getSize() = 0;
+    virtual bool isBusy() = 0;
+    
+    virtual void read(uint32_t address, uint8_t *data, uint16_t length) = 0;
+    
+    virtual void beginProgram(uint32_t address) = 0;
+    virtual void program(const uint8_t *data, uint16_t length) = 0;
+    virtual void endProgram() = 0;
+    
+    virtual void eraseSector(uint32_t address) = 0;
+};
+
+class FlashLog
+{
+  public:
+    FlashLog(FlashChip *chip);
+    
+    void begin();
+    void update();
+    
+    bool write(const uint8_t *data, uint16_t length);
+    void flush();
+    void erase();
+    
+    bool isIdle();
+    bool read(uint32_t address, uint8_t *data, uint16_t length);
+    
+    uint32_t getLength();
+    uint32_t getSize();
+    unsigned long getDropped();
+    
+  private:
+    FlashChip *_chip;
+    uint32_t _size;
+    
+    // A ring of pages: the oldest _queued are full and waiting for the chip, the one after them is filling
+    uint8_t _pages[FLASH_LOG_PAGES][FLASH_PAGE_SIZE];
+    uint32_t _address[FLASH_LOG_PAGES]; // Where each one goes
+    uint16_t _fill[FLASH_LOG_PAGES]; // How much of it there is
+    uint8_t _oldest;
+    uint8_t _queued;
+    
+    uint32_t _writeAddress; // Where the next byte we're given goes
+    uint32_t _erasedTo; // Everything from the end of the log up to here is erased and ready
+    
+    bool _sending; // In the middle of sending _pages[_oldest] to the chip
+    uint16_t _sent;
+    
+    bool _erasing; // erase() is working through the sectors below _eraseEnd
+    uint32_t _eraseAddress;
+    uint32_t _eraseEnd;
+    
+    unsigned long _dropped;
+    
+    bool pageErased(uint32_t page);
+};
+
+#endif
@@ -22,10 +22,17 @@ boolean isDescending = false;
 
 unsigned long commandTime = 0;
 
+float failsafeThrottle = 0.0;
+
 void processFlightCommand(){   
   
-  // Which mode?
-  if (systemMode == 0){
+  // Which mode? Autotune is flown by hand, it just takes over the level PIDs
+  if (systemMode == 0 || systemMode == 3){
+    if (receiver.isFailsafe()){
+      return processFailsafe();
+    }
+    
+    failsafeThrottle = engines.getThrottle();
     return processReceiverCommands();
   }
   
@@ -49,6 +56,26 @@ void processReceiverCommands(){
   engines.setThrottle(receiver.getSmoothedChannel(THROTTLE_CHANNEL)-MIN_MOTOR_SPEED); // Engines expect throttle to be 0-based
 }
 
+// We've lost the transmitter. FlightControl holds us level, and we come down gently until we're on the ground
+void processFailsafe(){
+  if (systemMode == 3){
+    autotune.stop();
+    systemMode = 0;
+  }
+  
+  // No arming without a transmitter, either
+  if (!engines.isArmed()) return;
+  
+  failsafeThrottle -= FAILSAFE_THROTTLE_RATE * (deltaTime / 1000000.0);
+  
+  if (failsafeThrottle <= 0){
+    engines.disarm();
+  }
+  else{
+    engines.setThrottle(failsafeThrottle);
+  }
+}
+
 void processAutoPilot(){
   if (commandTime == 0) commandTime = currentTime + 5000000;
   
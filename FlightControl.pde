@@ -18,12 +18,15 @@
 */
 
 #include "PID.h"
+#include "Control.h"
 
 // For tuning, see: http://en.wikipedia.org/wiki/PID_controller#Manual_tuning
 PID levelRollPID = PID(6.1, 0.0, 0.9);
 PID levelPitchPID = PID(6.1, 0.0, 0.9);
 PID headingHoldPID = PID(6.0, 0, 0.0);
 
+#include "Mixer.h"
+Mixer mixer;
 
 float currentRoll = 0.0;
 float currentPitch = 0.0;
@@ -40,17 +43,22 @@ void processFlightControl(){
   currentPitch = imu.getPitch();
   currentHeading = imu.getHeading();
   
+#if BATTERY_COMPENSATION
+  mixer.updateCompensation(battery.getData(), deltaTime / 1000000.0);
+#endif
+  
   //
   // Don't adjust pitch/roll if we are not armed!
   //
   
   if (engines.isArmed()){
+    if (blackbox.isFrozen()) blackbox.start(); // We just armed
      
     //
     // Panic!
     //
     
-    if (currentRoll > 90 || currentRoll < -90 || currentPitch > 90 || currentPitch < -90){
+    if (controlPanic(currentRoll, currentPitch)){
       engines.disarm();
     }
     
@@ -58,33 +66,56 @@ void processFlightControl(){
 
     // What does the receiver say?
     // TODO: Pull these from FlightCommand so that autopilot can adjust them
-    targetRoll = receiver.getAngle(ROLL_CHANNEL);
-    targetPitch = receiver.getAngle(PITCH_CHANNEL);
-    targetHeading = receiver.getAngle(YAW_CHANNEL);
+    if (receiver.isFailsafe() && (systemMode == 0 || systemMode == 3)){
+      // Nobody is flying, so just stay level and pointed where we are
+      targetRoll = 0.0;
+      targetPitch = 0.0;
+      targetHeading = currentHeading;
+    }
+    else{
+      targetRoll = receiver.getAngle(ROLL_CHANNEL);
+      targetPitch = receiver.getAngle(PITCH_CHANNEL);
+      targetHeading = receiver.getAngle(YAW_CHANNEL);
+    }
     
-    // Negative values mean the right side is up
-    // Constrain to 45 degrees, because beyond that, we're fucked anyway
-    float rollAdjust = levelRollPID.updatePID(targetRoll, constrain(currentRoll, -50, 50), G_Dt);
+    float target[3] = {targetRoll, targetPitch, targetHeading};
+    float current[3] = {currentRoll, currentPitch, currentHeading};
+    float adjust[3];
+    controlAttitude(&levelRollPID, &levelPitchPID, &headingHoldPID, target, current, G_Dt, adjust);
     
-    // Positive values mean the frontend is up
-    // Constrain to 45 degrees, because beyond that, we're fucked anyway
-    float pitchAdjust = levelPitchPID.updatePID(targetPitch, constrain(currentPitch, -50, 50), G_Dt);
+    float rollAdjust = adjust[ROLL];
+    float pitchAdjust = adjust[PITCH];
+    float headingAdjust = adjust[YAW];
     
-    // Positive values are to the right
-    float headingAdjust = headingHoldPID.updatePID(targetHeading, currentHeading, G_Dt);
+    // When autotuning, the relay replaces the PID on the axis being tuned
+    if (systemMode == 3 && autotune.getState() == AUTOTUNE_RUNNING){
+      if (autotune.getAxis() == ROLL){
+        rollAdjust = autotune.update(targetRoll, currentRoll);
+      }
+      else{
+        pitchAdjust = autotune.update(targetPitch, currentPitch);
+      }
+    }
     
     // Apply offsets to all motors evenly to ensure we pivot on the center
     int throttle = engines.getThrottle() + MIN_MOTOR_SPEED;
     if (throttle > MIN_MOTOR_SPEED){
-      engines.setEngineSpeed(LEFT_FRONT_MOTOR, throttle - rollAdjust - pitchAdjust + headingAdjust);
-      engines.setEngineSpeed(RIGHT_FRONT_MOTOR, throttle + rollAdjust - pitchAdjust - headingAdjust);
-      engines.setEngineSpeed(LEFT_REAR_MOTOR, throttle - rollAdjust + pitchAdjust - headingAdjust);
-      engines.setEngineSpeed(RIGHT_REAR_MOTOR, throttle + rollAdjust + pitchAdjust + headingAdjust);
+      mixer.mix(throttle, rollAdjust, pitchAdjust, headingAdjust);
+      
+      for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+        engines.setEngineSpeed(engine, mixer.getOutput(engine));
+      }
+      engines.commit();
     }
     else{
       engines.setAllSpeed(0);
+      
+      // Autotune only makes sense in the air
+      if (systemMode == 3) autotune.reset();
     }
     
+    recordBlackbox(rollAdjust, pitchAdjust, headingAdjust);
+    
     /*Serial.print(targetPitch);
     Serial.print(" | ");
     Serial.print(currentPitch);
@@ -93,9 +124,75 @@ void processFlightControl(){
     //delay(100);
   }
   else{
+    // Keep the last flight (or what's left after a panic) until we arm again
+    blackbox.freeze();
+    
     // Reset state
     levelRollPID.resetError();
     levelPitchPID.resetError();
     headingHoldPID.resetError();
+    
+    if (systemMode == 3) autotune.reset();
+  }
+  
+  if (systemMode == 3) processAutotune();
+}
+
+// One frame of what we saw, wanted and did
+void recordBlackbox(float rollAdjust, float pitchAdjust, float headingAdjust){
+  int32_t fields[BLACKBOX_FIELDS];
+  
+  fields[BLACKBOX_DELTA_TIME] = deltaTime;
+  fields[BLACKBOX_ROLL] = currentRoll * 100;
+  fields[BLACKBOX_PITCH] = currentPitch * 100;
+  fields[BLACKBOX_HEADING] = currentHeading * 100;
+  fields[BLACKBOX_TARGET_ROLL] = targetRoll * 100;
+  fields[BLACKBOX_TARGET_PITCH] = targetPitch * 100;
+  fields[BLACKBOX_TARGET_HEADING] = targetHeading * 100;
+  fields[BLACKBOX_GYRO_ROLL] = degrees(gyro.getRoll()) * 100; // The gyro is in radians/second
+  fields[BLACKBOX_GYRO_PITCH] = degrees(gyro.getPitch()) * 100;
+  fields[BLACKBOX_GYRO_YAW] = degrees(gyro.getYaw()) * 100;
+  fields[BLACKBOX_ROLL_ADJUST] = rollAdjust * 10;
+  fields[BLACKBOX_PITCH_ADJUST] = pitchAdjust * 10;
+  fields[BLACKBOX_HEADING_ADJUST] = headingAdjust * 10;
+  fields[BLACKBOX_THROTTLE] = engines.getThrottle();
+  
+  for (byte engine = 0; engine < 6; engine++){
+    fields[BLACKBOX_MOTORS + engine] = engine < ENGINE_COUNT ? engines.getEngineSpeed(engine) : 0;
+  }
+  
+  blackbox.record(fields);
+}
+
+// Tune roll, then pitch, then hand control back to the pilot
+// The proposed gains go straight into the level PIDs, so 'F' reports them and 'W' saves them
+void processAutotune(){
+  switch (autotune.getState()){
+    case AUTOTUNE_IDLE:
+      autotune.start(ROLL);
+      break;
+    case AUTOTUNE_COMPLETE:
+      if (autotune.getAxis() == ROLL){
+        applyAutotune(PARAM_LEVEL_ROLL_P, levelRollPID);
+        autotune.start(PITCH);
+      }
+      else{
+        applyAutotune(PARAM_LEVEL_PITCH_P, levelPitchPID);
+        autotune.stop();
+        systemMode = 0;
+      }
+      break;
+    case AUTOTUNE_ABORTED:
+      autotune.stop();
+      systemMode = 0;
+      break;
   }
 }
+
+// Through the parameters, so the gains get the same bounds as anything sent from the ground
+void applyAutotune(byte id, PID &pid){
+  setParameter(id, autotune.getP());
+  setParameter(id + 1, autotune.getI());
+  setParameter(id + 2, autotune.getD());
+  pid.resetError();
+}
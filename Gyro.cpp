@@ -56,22 +56,19 @@ void Gyro::init(){
 
 // Calculate zero for all 3 axis
 void Gyro::autoZero(){
-  // Take 50 measurements of all 3 axis, find the median, that's our zero-point
-  // Why 50? Because that's what the aeroquad project does
-  byte loopCount = 50;
-  
+  // Take ZERO_SAMPLES measurements of all 3 axis, find the median, that's our zero-point
   //Serial.print("Starting gyro autoZero with ");
-  //Serial.print(loopCount, DEC);
+  //Serial.print(ZERO_SAMPLES, DEC);
   //Serial.println(" iterations.");
-  int findZero[loopCount];
+  int findZero[ZERO_SAMPLES];
   for (byte axis = ROLL; axis <= YAW; axis++){
-    for (byte i=0; i<loopCount; i++){
+    for (byte i=0; i<ZERO_SAMPLES; i++){
       sendReadRequest(0x1D + (axis * 2));
-      findZero[i] = readWord();
+      findZero[i] = (int16_t)readWord();
       delay(10);
     }
     
-    zero[axis] = findMedian(findZero, loopCount);
+    zero[axis] = findMedian(findZero, ZERO_SAMPLES);
     //Serial.print("Zero of gyro axis ");
     //Serial.print(axis, DEC);
     //Serial.print(" is: ");
@@ -86,7 +83,7 @@ void Gyro::updateAll(){
   requestBytes(6);
 
   for (byte axis = ROLL; axis <= YAW; axis++){
-     dataRaw[axis] = zero[axis] - readNextWord();
+     dataRaw[axis] = zero[axis] - (int16_t)readNextWord();
      
      dataSmoothed[axis] = (float)dataRaw[axis] * _scaleFactor;
      
@@ -99,7 +96,7 @@ void Gyro::updateAll(){
 
 int Gyro::getTemp(){
   sendReadRequest(0x1B);
-  temp = readWord();
+  temp = (int16_t)readWord();
   temp = 35.0 + ((temp + 13200) / 280.0); // -13200 == 35C, 280 == Each degree
   temp = 32 + (temp * 1.8); // Convert to F
   
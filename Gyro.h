@@ -49,8 +49,6 @@ class Gyro : public I2C
     void unsleep();
     
   private:
-    I2C _i2c;
-    
     int temp; // Most recent temp (converted to degrees F)
     int dataRaw[3]; // Raw and unfiltered gyro data
     float dataSmoothed[3]; // Smoothed gyro data
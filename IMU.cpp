@@ -47,7 +47,15 @@ IMU::IMU(){
 void IMU::update(int dT, float gx, float gy, float gz, float ax, float ay, float az, float heading){
   updateAxis(ROLL, dT, gx, ax);
   updateAxis(PITCH, dT, gy, ay);
+  
+  // The compass wraps at 360, so blend it in the short way round from where we are, and keep the result in 0-360
+  if (heading - data[YAW] > 180) heading -= 360;
+  else if (heading - data[YAW] < -180) heading += 360;
+  
   updateAxis(YAW, dT, gz, heading);
+  
+  if (data[YAW] >= 360) data[YAW] -= 360;
+  else if (data[YAW] < 0) data[YAW] += 360;
 }
 
 // Get filtered roll angle
@@ -67,6 +75,16 @@ float IMU::getHeading(){
   return data[YAW];
 }
 
+// How much we trust the gyro over the accel, 0-1
+float IMU::getBias(){
+  return _a;
+}
+
+void IMU::setBias(float a){
+  _a = constrain(a, 0.0, 1.0);
+  _b = 1 - _a;
+}
+
 // Update an axis using the complementary filter
 // dT is in millis
 // gyro is gyro rotation rate in degrees/s
@@ -32,6 +32,9 @@ class IMU
     float getRoll();
     float getPitch();
     float getHeading();
+    
+    float getBias();
+    void setBias(float);
   
   private:
     void updateAxis(byte, int, float, float);
@@ -56,11 +56,15 @@ void Mag::updateAll(float roll, float pitch){
   requestBytes(6);
 
   // annoyingly, the registers are actually x,z,y (from the datasheet)
-  dataRaw[XAXIS] = readNextWordFlip() * _scale;
-  dataRaw[ZAXIS] = readNextWordFlip() * _scale;
-  dataRaw[YAXIS] = readNextWordFlip() * _scale;
+  dataRaw[XAXIS] = (int16_t)readNextWord() * _scale;
+  dataRaw[ZAXIS] = (int16_t)readNextWord() * _scale;
+  dataRaw[YAXIS] = (int16_t)readNextWord() * _scale;
   
-  // apply tilt compensation
+  compensate(dataRaw[XAXIS], dataRaw[YAXIS], dataRaw[ZAXIS], roll, pitch);
+}
+
+// Tilt-compensated heading from a raw field reading
+void Mag::compensate(int x, int y, int z, float roll, float pitch){
   // TODO: check signs on roll/pitch vs mag to make sure we're all speaking the same language
   roll = roll * PI / 180; // to radians
   pitch = pitch * PI / 180; // to radians
@@ -71,8 +75,8 @@ void Mag::updateAll(float roll, float pitch){
   float cosPitch = cos(pitch);
   float sinPitch = sin(pitch);
   
-  float Xh = dataRaw[XAXIS] * cosPitch + dataRaw[ZAXIS] * sinPitch;
-  float Yh = dataRaw[XAXIS] * sinRoll * sinPitch + dataRaw[YAXIS] * cosRoll - dataRaw[ZAXIS] * sinRoll * cosPitch;
+  float Xh = x * cosPitch + z * sinPitch;
+  float Yh = x * sinRoll * sinPitch + y * cosRoll - z * sinRoll * cosPitch;
   
   _heading = atan2(Yh, Xh);
    
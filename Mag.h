@@ -32,6 +32,7 @@ class Mag : public I2C
     void init();
     
     void updateAll(float roll, float pitch);
+    void compensate(int x, int y, int z, float roll, float pitch);
 
     int getRaw(byte axis); // The raw values from the sensor
 
@@ -39,8 +40,6 @@ class Mag : public I2C
     float getHeadingDegrees();
     
   private:
-    I2C _i2c;
-
     int dataRaw[3]; // Raw and unfiltered data
     float _heading; // tilt-compensated heading
     float _scale;
@@ -0,0 +1,105 @@
+/*
+  Memory.cpp - Free RAM and stack high water mark
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// RAM on the board is, from the bottom: .data, .bss, the heap (which grows up), then free space, then the stack
+// (which grows down from the top). Nothing stops the stack running into the heap or .bss, it just quietly
+// corrupts them.
+//
+// So before anything else runs, everything above .bss gets painted with STACK_PAINT. Later, however much of that
+// paint is still there above the heap is how close the stack has ever come. A byte the stack wrote that happens to
+// be STACK_PAINT looks unused, so it's a good guess rather than a promise.
+//
+// On the host there's no such layout, and everything is 0.
+//
+
+#include "WProgram.h"
+#include "Memory.h"
+
+#if defined(__AVR__)
+
+extern uint8_t __data_start; // Linker symbols
+extern uint8_t __heap_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+extern char *__brkval; // Top of the heap, 0 until the first malloc()
+
+// Runs before the C runtime has set up anything, even the stack pointer or r1, so it's all done in assembly
+void memoryPaint() __attribute__((naked, used, section(".init1")));
+void memoryPaint(){
+  __asm volatile (
+    "    ldi r30, lo8(_end)\n"
+    "    ldi r31, hi8(_end)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "    rjmp 2f\n"
+    "1:  st Z+, r24\n"
+    "2:  cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    "    breq 1b\n"
+    :: "M" (STACK_PAINT)
+  );
+}
+
+static uint8_t *heapEnd(){
+  return __brkval ? (uint8_t *)__brkval : &__heap_start;
+}
+
+#endif
+
+// Bytes between the top of the heap and the bottom of the stack, right now
+unsigned int memoryFree(){
+#if defined(__AVR__)
+  uint8_t top;
+  return &top - heapEnd();
+#else
+  return 0;
+#endif
+}
+
+// Most bytes of stack ever in use
+unsigned int memoryStackPeak(){
+#if defined(__AVR__)
+  uint8_t *p = heapEnd();
+  while (p <= &__stack && *p == STACK_PAINT) p++;
+  
+  return &__stack - p + 1;
+#else
+  return 0;
+#endif
+}
+
+// Bytes of .data and .bss, all the globals and statics together
+unsigned int memoryStatic(){
+#if defined(__AVR__)
+  return &_end - &__data_start;
+#else
+  return 0;
+#endif
+}
+
+// All of it
+unsigned int memorySize(){
+#if defined(__AVR__)
+  return &__stack - &__data_start + 1;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,31 @@
+/*
+  Memory.h - Free RAM and stack high water mark
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Memory_h
+#define Memory_h
+
+#include "WProgram.h"
+
+#define STACK_PAINT 0xC5 // What every byte between the heap and the stack starts as
+
+unsigned int memoryFree();
+unsigned int memoryStackPeak();
+unsigned int memoryStatic();
+unsigned int memorySize();
+
+#endif
@@ -0,0 +1,157 @@
+/*
+  Mixer.cpp - Library for turning throttle/roll/pitch/yaw commands into individual engine speeds
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "Mixer.h"
+#include "Utils.h"
+
+//
+// How much of each of roll, pitch and yaw goes to each engine.
+// Positive roll is more power on the right, positive pitch is more power in the rear,
+// positive yaw is more power on the engines that spin the same way as the left front one.
+//
+
+#if FRAME_TYPE == FRAME_X
+static const float mixTable[ENGINE_COUNT][3] = {
+  // Roll, Pitch, Yaw
+  { -1.0, -1.0,  1.0 }, // Left front
+  {  1.0, -1.0, -1.0 }, // Right front
+  { -1.0,  1.0, -1.0 }, // Left rear
+  {  1.0,  1.0,  1.0 }  // Right rear
+};
+#elif FRAME_TYPE == FRAME_PLUS
+static const float mixTable[ENGINE_COUNT][3] = {
+  // Roll, Pitch, Yaw
+  {  0.0, -1.0,  1.0 }, // Front (wired as left front)
+  {  1.0,  0.0, -1.0 }, // Right (wired as right front)
+  { -1.0,  0.0, -1.0 }, // Left (wired as left rear)
+  {  0.0,  1.0,  1.0 }  // Rear (wired as right rear)
+};
+#elif FRAME_TYPE == FRAME_HEX
+static const float mixTable[ENGINE_COUNT][3] = {
+  // Roll, Pitch, Yaw
+  { -0.5, -0.866,  1.0 }, // Left front
+  {  0.5, -0.866, -1.0 }, // Right front
+  { -0.5,  0.866,  1.0 }, // Left rear
+  {  0.5,  0.866, -1.0 }, // Right rear
+  { -1.0,  0.0,   -1.0 }, // Left middle
+  {  1.0,  0.0,    1.0 }  // Right middle
+};
+#else
+#error "Unknown FRAME_TYPE"
+#endif
+
+Mixer::Mixer(){
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    _outputs[engine] = MIN_MOTOR_SPEED;
+  }
+  
+  _throttle = 0;
+  _roll = 0;
+  _pitch = 0;
+  _yaw = 0;
+  
+  _voltage = BATTERY_NOMINAL_VOLTAGE;
+  _compensation = 1.0;
+}
+
+// Mix a throttle (in motor units) with roll/pitch/yaw corrections
+//
+// Rather than clipping each engine on its own (which changes the balance between them, and so
+// the attitude we end up with), if any engine would saturate we first scale all the corrections
+// down together, and then slide the collective throttle so that everything fits.
+void Mixer::mix(int throttle, float roll, float pitch, float yaw){
+  _throttle = throttle;
+  _roll = roll;
+  _pitch = pitch;
+  _yaw = yaw;
+  
+  float corrections[ENGINE_COUNT];
+  float highest = 0;
+  float lowest = 0;
+  
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    corrections[engine] = (roll * mixTable[engine][0] + pitch * mixTable[engine][1] + yaw * mixTable[engine][2]) * _compensation;
+    
+    if (corrections[engine] > highest) highest = corrections[engine];
+    if (corrections[engine] < lowest) lowest = corrections[engine];
+  }
+  
+  // Not enough room between min and max for the corrections? Shrink them, keeping their ratios
+  float spread = highest - lowest;
+  float scale = 1.0;
+  if (spread > (MAX_MOTOR_SPEED - MIN_MOTOR_SPEED)){
+    scale = (MAX_MOTOR_SPEED - MIN_MOTOR_SPEED) / spread;
+    highest *= scale;
+    lowest *= scale;
+  }
+  
+  // Now move the whole thing up or down so nothing is clipped
+  float collective = MIN_MOTOR_SPEED + ((throttle - MIN_MOTOR_SPEED) * _compensation);
+  if (collective + highest > MAX_MOTOR_SPEED) collective = MAX_MOTOR_SPEED - highest;
+  if (collective + lowest < MIN_MOTOR_SPEED) collective = MIN_MOTOR_SPEED - lowest;
+  
+  for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+    _outputs[engine] = collective + (corrections[engine] * scale);
+  }
+}
+
+int Mixer::getOutput(byte engine){
+  return _outputs[engine];
+}
+
+///////////
+
+// The same command gives less thrust as the battery sags, so scale everything we mix by nominal/measured voltage
+// voltage is straight from the battery monitor, dT is in seconds
+//
+// The voltage is noisy and dips every time the engines spin up, so it's smoothed, and the compensation is only
+// allowed to move slowly. Otherwise we'd be feeding the PIDs' own corrections back into them.
+void Mixer::updateCompensation(float voltage, float dT){
+  if (voltage < BATTERY_COMP_MIN_VOLTAGE) return;
+  
+  _voltage = filterSmooth(voltage, _voltage, BATTERY_COMP_SMOOTH);
+  
+  float target = constrain(BATTERY_NOMINAL_VOLTAGE / _voltage, BATTERY_COMP_MIN, BATTERY_COMP_MAX);
+  float step = BATTERY_COMP_RATE * dT;
+  _compensation += constrain(target - _compensation, -step, step);
+}
+
+float Mixer::getCompensation(){
+  return _compensation;
+}
+
+///////////
+
+int Mixer::getThrottle(){
+  return _throttle;
+}
+
+float Mixer::getRoll(){
+  return _roll;
+}
+
+float Mixer::getPitch(){
+  return _pitch;
+}
+
+float Mixer::getYaw(){
+  return _yaw;
+}
@@ -0,0 +1,55 @@
+/*
+  Mixer.h - Library for turning throttle/roll/pitch/yaw commands into individual engine speeds
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Mixer_h
+#define Mixer_h
+
+#include "WProgram.h"
+#include "Definitions.h"
+
+class Mixer
+{
+  public:
+    Mixer();
+    
+    void mix(int, float, float, float);
+    
+    int getOutput(byte);
+    
+    void updateCompensation(float, float);
+    float getCompensation();
+    
+    // The last inputs we mixed, aka the "motor axis commands"
+    int getThrottle();
+    float getRoll();
+    float getPitch();
+    float getYaw();
+    
+  private:
+    int _outputs[ENGINE_COUNT];
+    
+    int _throttle;
+    float _roll;
+    float _pitch;
+    float _yaw;
+    
+    float _voltage; // Filtered battery voltage
+    float _compensation; // How much to scale everything by for the battery
+};
+
+#endif
@@ -31,7 +31,9 @@ PID::PID(){
 }
 
 PID::PID(float p, float i, float d){
-  PID();
+  // Calling PID() in here would only construct and throw away a temporary, so this has to start from scratch too
+  iState = 0;
+  last = 0;
   
   pgain = p;
   igain = i;
@@ -0,0 +1,84 @@
+/*
+  PPMDecoder.cpp - Library for decoding a PPM-sum (aka CPPM) RC receiver stream
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// PPM-sum puts every channel on one wire: a short pulse starts each channel, and the time from one
+// pulse to the next is that channel's width. A long gap marks the end of the frame.
+//
+
+#include "PPMDecoder.h"
+
+PPMDecoder::PPMDecoder(){
+  _index = 0;
+  _count = 0;
+  _synced = false;
+}
+
+// Feed in the time between two pulses, in microseconds
+// Returns true if that completed a frame
+bool PPMDecoder::push(uint16_t width){
+  if (width >= PPM_SYNC_WIDTH){
+    // Unless idle() already saw the gap coming and handed the frame over
+    bool complete = _synced && _index >= PPM_MIN_CHANNELS;
+    if (complete) finishFrame();
+    
+    _synced = true;
+    _index = 0;
+    return complete;
+  }
+  
+  if (!_synced) return false;
+  
+  // A glitch, or too many channels. Either way, wait for the next sync
+  if (width < RECEIVER_MIN_PULSE || width > RECEIVER_MAX_PULSE || _index >= PPM_MAX_CHANNELS){
+    _synced = false;
+    return false;
+  }
+  
+  _pending[_index++] = width;
+  return false;
+}
+
+// How long it's been since the last pulse, in microseconds, while we wait for the next
+// The sync gap can only be measured once it ends, but longer than any channel, it can't be anything else. So the frame
+// is over a couple of milliseconds after its last channel, rather than a whole sync gap later
+// Returns true if that completed a frame
+bool PPMDecoder::idle(uint16_t elapsed){
+  if (elapsed <= RECEIVER_MAX_PULSE || !_synced || _index < PPM_MIN_CHANNELS) return false;
+  
+  finishFrame();
+  _index = 0; // So the sync, when it does end, doesn't hand it over again
+  return true;
+}
+
+void PPMDecoder::finishFrame(){
+  for (uint8_t i=0; i<_index; i++){
+    _channels[i] = _pending[i];
+  }
+  _count = _index;
+}
+
+uint8_t PPMDecoder::getChannelCount(){
+  return _count;
+}
+
+// In microseconds
+uint16_t PPMDecoder::getChannel(uint8_t channel){
+  return _channels[channel];
+}
@@ -0,0 +1,52 @@
+/*
+  PPMDecoder.h - Library for decoding a PPM-sum (aka CPPM) RC receiver stream
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef PPMDecoder_h
+#define PPMDecoder_h
+
+// No Arduino dependencies in here, so that the host tools can replay recorded streams through it
+#include <stdint.h>
+#include "Definitions.h"
+
+#define PPM_MAX_CHANNELS 12
+#define PPM_MIN_CHANNELS 4 // Fewer than this between syncs and it isn't a real frame
+#define PPM_SYNC_WIDTH 2700 // Any gap longer than this is the end of a frame, in microseconds
+
+class PPMDecoder
+{
+  public:
+    PPMDecoder();
+    
+    bool push(uint16_t);
+    bool idle(uint16_t);
+    
+    uint8_t getChannelCount();
+    uint16_t getChannel(uint8_t);
+    
+  private:
+    void finishFrame();
+    
+    uint16_t _pending[PPM_MAX_CHANNELS]; // The frame we are in the middle of
+    uint16_t _channels[PPM_MAX_CHANNELS]; // The last complete frame
+    
+    uint8_t _index;
+    uint8_t _count;
+    bool _synced;
+};
+
+#endif
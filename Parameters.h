@@ -0,0 +1,60 @@
+/*
+  Parameters.h - The table of everything that can be tuned from the ground
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Parameters_h
+#define Parameters_h
+
+// No Arduino dependencies in here, so that a ground station can share the IDs
+#include <stdint.h>
+
+// Types
+#define PARAM_FLOAT 0
+#define PARAM_INT 1
+
+// IDs. These are what goes over the serial port, so only ever add to the end
+#define PARAM_LEVEL_ROLL_P 0
+#define PARAM_LEVEL_ROLL_I 1
+#define PARAM_LEVEL_ROLL_D 2
+#define PARAM_LEVEL_PITCH_P 3
+#define PARAM_LEVEL_PITCH_I 4
+#define PARAM_LEVEL_PITCH_D 5
+#define PARAM_HEADING_P 6
+#define PARAM_HEADING_I 7
+#define PARAM_HEADING_D 8
+#define PARAM_RECEIVER_RATE 9
+#define PARAM_RECEIVER_EXPO 10
+#define PARAM_RECEIVER_SMOOTH 11
+#define PARAM_ACCEL_SMOOTH 12
+#define PARAM_IMU_BIAS 13
+#define PARAM_FAILSAFE_TIMEOUT 14
+#define PARAM_SERIAL_TX_BUDGET 15
+#define PARAM_MIN_ACRO 16
+#define PARAM_LEVEL_LIMIT 17
+#define PARAM_LEVEL_OFF 18
+#define PARAM_GYRO_SMOOTH 19
+#define PARAM_TIME_CONSTANT 20
+#define PARAM_COUNT 21
+
+struct Parameter {
+  uint8_t type;
+  float min;
+  float max;
+  float def; // Default
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+  Parameters.pde - Get, set, save and load everything that can be tuned, by ID
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Every tunable in one place, with its bounds and default. The ground station gets and sets them by ID
+// (see Parameters.h) instead of needing a letter command for each. Each one is stored in config.parameters[ID].
+//
+// The table lives in flash. The values themselves stay where they always have, in the objects that use them.
+//
+
+// AeroQuad settings we don't fly with yet, kept so a configurator gets back what it set ('B', 'H' and 'L')
+int minAcro;
+float levelLimit;
+float levelOff;
+float gyroSmoothFactor;
+float timeConstant;
+
+#include <avr/pgmspace.h>
+
+const Parameter parameters[PARAM_COUNT] PROGMEM = {
+  // type, min, max, default
+  {PARAM_FLOAT, 0.0, 50.0, 6.1}, // PARAM_LEVEL_ROLL_P
+  {PARAM_FLOAT, 0.0, 10.0, 0.0}, // PARAM_LEVEL_ROLL_I
+  {PARAM_FLOAT, 0.0, 10.0, 0.9}, // PARAM_LEVEL_ROLL_D
+  {PARAM_FLOAT, 0.0, 50.0, 6.1}, // PARAM_LEVEL_PITCH_P
+  {PARAM_FLOAT, 0.0, 10.0, 0.0}, // PARAM_LEVEL_PITCH_I
+  {PARAM_FLOAT, 0.0, 10.0, 0.9}, // PARAM_LEVEL_PITCH_D
+  {PARAM_FLOAT, 0.0, 50.0, 6.0}, // PARAM_HEADING_P
+  {PARAM_FLOAT, 0.0, 10.0, 0.0}, // PARAM_HEADING_I
+  {PARAM_FLOAT, 0.0, 10.0, 0.0}, // PARAM_HEADING_D
+  {PARAM_FLOAT, 0.1, 2.0, 1.0}, // PARAM_RECEIVER_RATE
+  {PARAM_FLOAT, 0.0, 1.0, 0.0}, // PARAM_RECEIVER_EXPO
+  {PARAM_FLOAT, 0.01, 1.0, 1.0}, // PARAM_RECEIVER_SMOOTH
+  {PARAM_FLOAT, 0.01, 1.0, 0.8}, // PARAM_ACCEL_SMOOTH
+  {PARAM_FLOAT, 0.0, 1.0, 0.96}, // PARAM_IMU_BIAS
+  {PARAM_INT, 50, 5000, RECEIVER_FAILSAFE_TIMEOUT}, // PARAM_FAILSAFE_TIMEOUT
+  {PARAM_INT, SERIAL_TX_MIN_BUDGET, 256, SERIAL_TX_BUDGET}, // PARAM_SERIAL_TX_BUDGET
+  {PARAM_INT, 1000, 2000, 1300}, // PARAM_MIN_ACRO
+  {PARAM_FLOAT, 0.0, 1000.0, 500.0}, // PARAM_LEVEL_LIMIT
+  {PARAM_FLOAT, 0.0, 1000.0, 150.0}, // PARAM_LEVEL_OFF
+  {PARAM_FLOAT, 0.01, 1.0, 1.0}, // PARAM_GYRO_SMOOTH
+  {PARAM_FLOAT, 0.0, 100.0, 7.0}, // PARAM_TIME_CONSTANT
+};
+
+// The current value, wherever it lives
+float getParameter(byte id){
+  switch (id){
+    case PARAM_LEVEL_ROLL_P: return levelRollPID.getP();
+    case PARAM_LEVEL_ROLL_I: return levelRollPID.getI();
+    case PARAM_LEVEL_ROLL_D: return levelRollPID.getD();
+    case PARAM_LEVEL_PITCH_P: return levelPitchPID.getP();
+    case PARAM_LEVEL_PITCH_I: return levelPitchPID.getI();
+    case PARAM_LEVEL_PITCH_D: return levelPitchPID.getD();
+    case PARAM_HEADING_P: return headingHoldPID.getP();
+    case PARAM_HEADING_I: return headingHoldPID.getI();
+    case PARAM_HEADING_D: return headingHoldPID.getD();
+    case PARAM_RECEIVER_RATE: return receiver.getRate();
+    case PARAM_RECEIVER_EXPO: return receiver.getExpo();
+    case PARAM_RECEIVER_SMOOTH: return receiver.getSmoothFactor();
+    case PARAM_ACCEL_SMOOTH: return accel.getSmoothFactor();
+    case PARAM_IMU_BIAS: return imu.getBias();
+    case PARAM_FAILSAFE_TIMEOUT: return receiver.getFailsafeTimeout();
+    case PARAM_SERIAL_TX_BUDGET: return serialTX.getBudget();
+    case PARAM_MIN_ACRO: return minAcro;
+    case PARAM_LEVEL_LIMIT: return levelLimit;
+    case PARAM_LEVEL_OFF: return levelOff;
+    case PARAM_GYRO_SMOOTH: return gyroSmoothFactor;
+    case PARAM_TIME_CONSTANT: return timeConstant;
+  }
+  
+  return 0;
+}
+
+// Clamped to the parameter's bounds (and rounded, for ints) before it's used
+// Returns false if there's no such parameter
+boolean setParameter(byte id, float value){
+  if (id >= PARAM_COUNT) return false;
+  
+  Parameter param;
+  memcpy_P(&param, &parameters[id], sizeof(param));
+  
+  if (isnan(value)) value = param.def;
+  value = constrain(value, param.min, param.max);
+  if (param.type == PARAM_INT) value = (long)(value + 0.5);
+  
+  switch (id){
+    case PARAM_LEVEL_ROLL_P: levelRollPID.setP(value); break;
+    case PARAM_LEVEL_ROLL_I: levelRollPID.setI(value); break;
+    case PARAM_LEVEL_ROLL_D: levelRollPID.setD(value); break;
+    case PARAM_LEVEL_PITCH_P: levelPitchPID.setP(value); break;
+    case PARAM_LEVEL_PITCH_I: levelPitchPID.setI(value); break;
+    case PARAM_LEVEL_PITCH_D: levelPitchPID.setD(value); break;
+    case PARAM_HEADING_P: headingHoldPID.setP(value); break;
+    case PARAM_HEADING_I: headingHoldPID.setI(value); break;
+    case PARAM_HEADING_D: headingHoldPID.setD(value); break;
+    case PARAM_RECEIVER_RATE: receiver.setCurve(value, receiver.getExpo()); break;
+    case PARAM_RECEIVER_EXPO: receiver.setCurve(receiver.getRate(), value); break;
+    case PARAM_RECEIVER_SMOOTH: receiver.setSmoothFactor(value); break;
+    case PARAM_ACCEL_SMOOTH: accel.setSmoothFactor(value); break;
+    case PARAM_IMU_BIAS: imu.setBias(value); break;
+    case PARAM_FAILSAFE_TIMEOUT: receiver.setFailsafeTimeout(value); break;
+    case PARAM_SERIAL_TX_BUDGET: serialTX.setBudget(value); break;
+    case PARAM_MIN_ACRO: minAcro = value; break;
+    case PARAM_LEVEL_LIMIT: levelLimit = value; break;
+    case PARAM_LEVEL_OFF: levelOff = value; break;
+    case PARAM_GYRO_SMOOTH: gyroSmoothFactor = value; break;
+    case PARAM_TIME_CONSTANT: timeConstant = value; break;
+  }
+  
+  return true;
+}
+
+///////////
+
+// Everything back to how it was built
+void resetParameters(){
+  for (byte id = 0; id < PARAM_COUNT; id++){
+    setParameter(id, pgm_read_float(&parameters[id].def));
+  }
+}
+
+// Into the eeprom config. eeprom_write_all() actually stores it
+void saveParameters(){
+  for (byte id = 0; id < PARAM_COUNT; id++){
+    config.parameters[id] = getParameter(id);
+  }
+}
+
+// Anything missing gets the default instead, and anything out of bounds (say the bounds got tighter) is clamped
+void loadParameters(){
+  for (byte id = 0; id < PARAM_COUNT; id++){
+    setParameter(id, config.parameters[id]);
+  }
+}
+
+///////////
+
+boolean configWaiting = false; // There's a save waiting for us to disarm
+
+// Store every setting in eeprom. The writing happens in the background, but we still don't touch eeprom while armed
+// (a brownout mid-write corrupts it), so then it waits until we disarm, unless forced
+void saveConfig(boolean force){
+  receiver.save();
+  saveParameters();
+  
+  if (engines.isArmed() && !force){
+    configWaiting = true;
+    return;
+  }
+  
+  configWaiting = false;
+  eeprom_write_all();
+}
+
+// Once per loop
+void updateConfig(){
+  if (configWaiting && !engines.isArmed()) saveConfig(false);
+}
@@ -31,6 +31,7 @@
 #include "INS.h"
 
 #include "PID.h"
+#include "Parameters.h"
 
 Gyro gyro;
 Accel accel;
@@ -48,18 +49,41 @@ Receiver receiver;
 #include "Battery.h"
 Battery battery;
 
+#include "Autotune.h"
+Autotune autotune; // See processAutotune()
+
+#include "Telemetry.h"
+#include "Benchmark.h" // Only run on request, see the 'm' serial command
+#include "Memory.h" // The stack is painted before setup(), see the 'h' serial command
+
+#include "Blackbox.h"
+#if BLACKBOX_FLASH
+#include "SPIFlash.h"
+SPIFlash flash(FLASH_CS_PIN);
+FlashLog flashLog(&flash); // Needs update() every loop
+Blackbox blackbox(&flashLog); // Started on arming, frozen on disarming, see processFlightControl()
+#else
+byte blackboxBuffer[BLACKBOX_SIZE];
+Blackbox blackbox(blackboxBuffer, BLACKBOX_SIZE); // Started on arming, frozen on disarming, see processFlightControl()
+#endif
+#include "SerialTX.h"
+SerialTX serialTX; // Everything we send goes through this, not Serial.print()
+
 // Status
-byte systemMode = 0; // 0: Manual, 1: Auto, 2: PID Test
+byte systemMode = 0; // 0: Manual, 1: Auto, 2: PID Test, 3: Autotune
 byte activityLight = 0; // 0: Off, 1: On
 
 unsigned long previousTime = 0;
 unsigned long currentTime = 0;
 unsigned long deltaTime = 0;
 unsigned long serialTime = 0;
+unsigned long telemetryTime = 0; // How long the last sendSerialTelemetry() took, in microseconds
 unsigned long activityTime = 0;
+unsigned long alarmTime = 0;
 
 void setup(){
   Serial.begin(115200);
+  serialTX.init();
   Wire.begin(); // For the gyro and accel
   
   //
@@ -73,14 +97,25 @@ void setup(){
   // Run inits
   //
 
+  eeprom_read_all(); // Before anything that wants its settings
+  
   battery.init();
   engines.init();
+  receiver.init();
 
   gyro.init();
   accel.init();
   baro.init();
   mag.init();
   
+#if BLACKBOX_FLASH
+  flash.init();
+  flashLog.begin();
+#endif
+  
+  receiver.load();
+  loadParameters();
+  
   //
   // It's go time
   //
@@ -121,6 +156,13 @@ void loop(){
   
   processFlightCommand();
   
+  // Store settings, once it's safe to
+  updateConfig();
+  
+#if BLACKBOX_FLASH
+  flashLog.update();
+#endif
+  
   //
   // Read serial commands and set them/reply
   //
@@ -129,7 +171,11 @@ void loop(){
     serialTime = currentTime + SERIAL_RATE;
     
     readSerialCommand();
+    
+    unsigned long telemetryStart = micros();
+    serialTX.resetBudget();
     sendSerialTelemetry();
+    telemetryTime = micros() - telemetryStart;
   }
   
   if (currentTime > activityTime){
@@ -144,4 +190,10 @@ void loop(){
       activityLight = 1;
     }
   }
+  
+  if (currentTime > alarmTime){
+    alarmTime = currentTime + ALARM_RATE;
+    
+    battery.updateAlarm();
+  }
 }
@@ -21,58 +21,468 @@
 #include "Definitions.h"
 #include "Receiver.h"
 #include "Utils.h"
+#include "EEPROM_lib.h"
+#include <avr/interrupt.h>
+
+//
+// Each kind of receiver fills in the same thing: the latest pulse width for each channel, plus a bitmask of which
+// channels have something new. Nothing here ever waits on the receiver; the interrupts do the listening, and
+// updateAll() just picks up whatever they have.
+//
+
+#if RECEIVER_TYPE == RECEIVER_PWM
+
+//
+// One wire per channel. Rather than waiting on each channel with pulseIn(), the pin change interrupt for port K
+// (A8-A15) timestamps every edge against timer 1 (free running at 2 ticks per microsecond), and keeps the
+// most recent width for each channel.
+//
+
+#define RECEIVER_FIRST_PIN 62 // A8 is bit 0 of port K
+
+static byte rcBitChannel[8]; // Which channel is on each bit of port K
+static volatile byte rcLastPins; // Port K as of the last interrupt
+static volatile uint16_t rcRise[8]; // Timer 1 at the last rising edge, per bit
+static volatile unsigned int rcWidths[CHANNELS]; // Latest good pulse width per channel, in microseconds
+static volatile byte rcFresh; // Bitmask of channels with a new pulse since the last updateAll()
+
+ISR(PCINT2_vect){
+  uint16_t now = TCNT1;
+  byte pins = PINK;
+  byte changed = (pins ^ rcLastPins) & PCMSK2;
+  rcLastPins = pins;
+  
+  for (byte bit = 0; bit < 8; bit++){
+    byte mask = 1 << bit;
+    if (!(changed & mask)) continue;
+    
+    if (pins & mask){
+      rcRise[bit] = now;
+    }
+    else{
+      unsigned int width = (uint16_t)(now - rcRise[bit]) >> 1; // Wraps neatly, since timer 1 is 16 bits too
+      
+      // Anything outside of this is noise, or a glitch
+      if (width >= RECEIVER_MIN_PULSE && width <= RECEIVER_MAX_PULSE){
+        byte channel = rcBitChannel[bit];
+        rcWidths[channel] = width;
+        rcFresh |= 1 << channel;
+      }
+    }
+  }
+}
+
+static void receiverBegin(int *channels){
+  byte mask = 0;
+  
+  // Assign all pins for reading
+  for (byte i=0; i<CHANNELS; i++){
+    pinMode(channels[i], INPUT);
+    
+    byte bit = channels[i] - RECEIVER_FIRST_PIN;
+    rcBitChannel[bit] = i;
+    mask |= 1 << bit;
+  }
+  
+  // Timer 1 just counts, at 2 ticks per microsecond
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  
+  rcLastPins = PINK;
+  PCMSK2 = mask;
+  PCICR |= _BV(PCIE2);
+}
+
+static byte receiverRead(int *channels, unsigned int *widths){
+  // Grab a consistent copy of what the interrupt has seen. This takes a couple of microseconds
+  uint8_t oldSREG = SREG;
+  cli();
+  for (byte i=0; i<CHANNELS; i++){
+    widths[i] = rcWidths[i];
+  }
+  byte fresh = rcFresh;
+  rcFresh = 0;
+  SREG = oldSREG;
+  
+  return fresh;
+}
+
+#elif RECEIVER_TYPE == RECEIVER_PPM
+
+//
+// Every channel on one wire, into the input capture pin of timer 5. The capture interrupt only works out the time
+// since the last pulse and drops it in a ring buffer; the decoding happens in updateAll().
+//
+
+#include "PPMDecoder.h"
+
+#define PPM_RING_SIZE 32 // Two full frames, plenty for one pass of the loop. Must be a power of 2
+
+static volatile unsigned int ppmRing[PPM_RING_SIZE];
+static volatile byte ppmHead; // Written by the interrupt
+static volatile byte ppmTail; // Written by updateAll()
+static volatile uint16_t ppmLastCapture; // Also read by updateAll(), to time the sync gap
+
+static PPMDecoder ppm;
+
+ISR(TIMER5_CAPT_vect){
+  uint16_t now = ICR5;
+  
+  byte next = (ppmHead + 1) & (PPM_RING_SIZE - 1);
+  if (next != ppmTail){ // If we're full, drop it. The decoder will lose sync and pick up at the next frame
+    ppmRing[ppmHead] = (uint16_t)(now - ppmLastCapture) >> 1;
+    ppmHead = next;
+  }
+  
+  ppmLastCapture = now;
+}
+
+static void receiverBegin(int *channels){
+  pinMode(RECEIVER_PPM_PIN, INPUT);
+  
+  // Timer 5 counts at 2 ticks per microsecond, capturing on rising edges with the noise canceller on
+  TCCR5A = 0;
+  TCCR5B = _BV(ICNC5) | _BV(ICES5) | _BV(CS51);
+  TIMSK5 = _BV(ICIE5);
+}
+
+static byte receiverRead(int *channels, unsigned int *widths){
+  boolean complete = false;
+  
+  while (ppmTail != ppmHead){
+    if (ppm.push(ppmRing[ppmTail])) complete = true;
+    ppmTail = (ppmTail + 1) & (PPM_RING_SIZE - 1);
+  }
+  
+  // If nothing new has come in since, see if we're far enough into the sync gap to call the frame finished
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t elapsed = (uint16_t)(TCNT5 - ppmLastCapture) >> 1;
+  boolean caughtUp = ppmTail == ppmHead;
+  SREG = oldSREG;
+  
+  if (caughtUp && ppm.idle(elapsed)) complete = true;
+  
+  if (!complete) return 0;
+  
+  byte fresh = 0;
+  for (byte i=0; i<CHANNELS; i++){
+    if (channels[i] < ppm.getChannelCount()){
+      widths[i] = ppm.getChannel(channels[i]);
+      fresh |= 1 << i;
+    }
+  }
+  
+  return fresh;
+}
+
+#elif RECEIVER_TYPE == RECEIVER_SBUS
+
+//
+// A serial receiver on one of the spare hardware UARTs. The core's receive interrupt already puts every byte
+// into a ring buffer for us, so all we do is drain it through the decoder.
+//
+
+#include "SBusDecoder.h"
+
+static SBusDecoder sbus;
+
+static void receiverBegin(int *channels){
+  RECEIVER_SERIAL.begin(SBUS_BAUD);
+  
+  // Serial.begin() only does 8N1, S.BUS is 8E2
+  RECEIVER_SERIAL_UCSRC = _BV(UPM11) | _BV(USBS1) | _BV(UCSZ11) | _BV(UCSZ10);
+}
+
+static byte receiverRead(int *channels, unsigned int *widths){
+  boolean complete = false;
+  
+  while (RECEIVER_SERIAL.available()){
+    if (sbus.push(RECEIVER_SERIAL.read())) complete = true;
+  }
+  
+  // A failsafe frame is the receiver making numbers up, so don't believe it
+  if (!complete || (sbus.getFlags() & SBUS_FLAG_FAILSAFE)) return 0;
+  
+  for (byte i=0; i<CHANNELS; i++){
+    widths[i] = sbus.getChannel(channels[i]);
+  }
+  
+  return (1 << CHANNELS) - 1;
+}
+
+#else
+#error "Unknown RECEIVER_TYPE"
+#endif
 
 Receiver::Receiver(){
+#if RECEIVER_TYPE == RECEIVER_PWM
   // These may seem arbitrary, but they are what the AeroQuad software uses,
   // so I am using the same, for consistency
   //
   // However, for some reason that I have not yet discovered, Yaw and Roll seem to be swapped from what my receiver is labeled
-  channels[THROTTLE_CHANNEL] = 4; // Throttle
-  channels[ROLL_CHANNEL] = 2; // Rudd. / Roll
-  channels[PITCH_CHANNEL] = 5; // Elev. / Pitch
-  channels[YAW_CHANNEL] = 6; // Aile / Yaw
-  channels[GEAR_CHANNEL] = 7; // Gear
-  channels[AUX_CHANNEL] = 8; // Aux / Flt Mode
+  //
+  // The receiver lives on A8-A13, since pins 2-8 are taken by the ESCs (see Definitions.h)
+  channels[THROTTLE_CHANNEL] = 63; // A9: Throttle
+  channels[ROLL_CHANNEL] = 62; // A8: Rudd. / Roll
+  channels[PITCH_CHANNEL] = 64; // A10: Elev. / Pitch
+  channels[YAW_CHANNEL] = 65; // A11: Aile / Yaw
+  channels[GEAR_CHANNEL] = 66; // A12: Gear
+  channels[AUX_CHANNEL] = 67; // A13: Aux / Flt Mode
+#else
+  // For PPM and serial receivers, these are positions in the frame instead of pins. AETR is the most common order
+  channels[ROLL_CHANNEL] = 0; // Aileron
+  channels[PITCH_CHANNEL] = 1; // Elevator
+  channels[THROTTLE_CHANNEL] = 2; // Throttle
+  channels[YAW_CHANNEL] = 3; // Rudder
+  channels[GEAR_CHANNEL] = 4; // Gear
+  channels[AUX_CHANNEL] = 5; // Aux / Flt Mode
+#endif
   
   int i;
-  // Assign all pins for reading
-  for (i=0; i<CHANNELS; i++){
-    pinMode(channels[i], INPUT);
-  }
-
   // Init the readings at something sensible
   for (i=0; i<CHANNELS; i++){
     smoothed[i] = (i == THROTTLE_CHANNEL) ? 1000 : 1500;
     readings[i] = smoothed[i];
+    lastFrame[i] = 0;
   }
 
   _smoothFactor = 1.0;
+  
+  // No news is bad news
+  _failsafeTimeout = RECEIVER_FAILSAFE_TIMEOUT;
+  _failsafe = true;
+  
+  // Assume a perfect receiver until we're told otherwise
+  _calibrating = false;
+  resetCalibration();
+  
+  _rate = 1.0;
+  _expo = 0.0;
+  buildCurve();
+}
+
+// Has to happen in setup(), after the Arduino core is done claiming timers for itself
+void Receiver::init(){
+  receiverBegin(channels);
 }
 
 void Receiver::updateAll(){
-  int temp;
-  int i;
+  unsigned int widths[CHANNELS];
+  byte fresh = receiverRead(channels, widths);
+  unsigned long now = millis();
   
-  // Read all the channels. Worst case, this will take 180us
-  for (i=0; i<CHANNELS; i++){
-    temp = pulseIn(channels[i], HIGH, 20000); // Attempt to read a pulse for 20us
-    if (temp != 0){ // A value of 0 means that the read timed out, so we keep our previous value
-      smoothed[i] = filterSmooth(temp, readings[i], _smoothFactor); // Apply smoothing
-      readings[i] = temp;
+  for (byte i=0; i<CHANNELS; i++){
+    if (fresh & (1 << i)){ // No new pulse means we keep our previous value
+      int width = widths[i];
+      
+      if (_calibrating){
+        if (width < calMin[i]) calMin[i] = width;
+        if (width > calMax[i]) calMax[i] = width;
+      }
+      
+      smoothed[i] = filterSmooth(applyCalibration(i, width), smoothed[i], _smoothFactor); // Apply smoothing
+      readings[i] = width;
+      lastFrame[i] = now;
     }
   }
+  
+  _failsafe = getFrameAge() > _failsafeTimeout;
 }
 
-// TODO: Apply some sort of centering to these, since the offsets differ from receiver to receiver
+// Straight from the receiver, in microseconds
 int Receiver::getChannel(byte channel){
   return readings[channel];
 }
 
+// Calibrated onto 1000-2000, and smoothed
 float Receiver::getSmoothedChannel(byte channel){
   return smoothed[channel];
 }
 
+// Stick position as a target angle, in degrees, with rate and expo applied
+// This runs every loop, so it's a table lookup rather than any float math
 float Receiver::getAngle(byte channel){
-  // Scale 1000-2000 usecs to -45 to 45 degrees
-  return (0.09 * smoothed[channel]) - 135;
+  int deflection = (int)smoothed[channel] - 1500;
+  boolean negative = deflection < 0;
+  if (negative) deflection = -deflection;
+  if (deflection > 500) deflection = 500;
+  
+  // Straight line between the two nearest points
+  byte point = deflection >> 5;
+  int fraction = deflection & 31;
+  int angle = curve[point] + (((long)(curve[point+1] - curve[point]) * fraction) >> 5);
+  
+  return (negative ? -angle : angle) * 0.01;
+}
+
+///////////
+
+// Put the sticks in the middle and the throttle down, then start
+void Receiver::startCalibration(){
+  for (byte i=0; i<CHANNELS; i++){
+    calMin[i] = readings[i];
+    calCenter[i] = readings[i];
+    calMax[i] = readings[i];
+  }
+  
+  _calibrating = true;
+}
+
+// Move everything to its limits, then stop
+void Receiver::stopCalibration(){
+  _calibrating = false;
+  
+  // Throttle and switches don't have a center worth speaking of
+  calCenter[THROTTLE_CHANNEL] = (calMin[THROTTLE_CHANNEL] + calMax[THROTTLE_CHANNEL]) / 2;
+  calCenter[GEAR_CHANNEL] = (calMin[GEAR_CHANNEL] + calMax[GEAR_CHANNEL]) / 2;
+  calCenter[AUX_CHANNEL] = (calMin[AUX_CHANNEL] + calMax[AUX_CHANNEL]) / 2;
+  
+  for (byte i=0; i<CHANNELS; i++){
+    // Didn't move it? Then we learned nothing
+    if (calMax[i] - calCenter[i] < 100 || calCenter[i] - calMin[i] < 100){
+      calMin[i] = 1000;
+      calCenter[i] = 1500;
+      calMax[i] = 2000;
+    }
+    
+    updateScale(i);
+  }
+}
+
+boolean Receiver::isCalibrating(){
+  return _calibrating;
+}
+
+int Receiver::getMin(byte channel){
+  return calMin[channel];
+}
+
+int Receiver::getCenter(byte channel){
+  return calCenter[channel];
+}
+
+int Receiver::getMax(byte channel){
+  return calMax[channel];
+}
+
+void Receiver::resetCalibration(){
+  for (byte i=0; i<CHANNELS; i++){
+    calMin[i] = 1000;
+    calCenter[i] = 1500;
+    calMax[i] = 2000;
+    updateScale(i);
+  }
+}
+
+void Receiver::updateScale(byte channel){
+  scaleLow[channel] = (500L << 16) / (calCenter[channel] - calMin[channel]);
+  scaleHigh[channel] = (500L << 16) / (calMax[channel] - calCenter[channel]);
+}
+
+// Map a raw pulse onto 1000-2000, with this receiver's center at 1500
+int Receiver::applyCalibration(byte channel, int width){
+  long offset = width - calCenter[channel];
+  
+  if (offset < 0){
+    offset = -((-offset * scaleLow[channel]) >> 16);
+  }
+  else{
+    offset = (offset * scaleHigh[channel]) >> 16;
+  }
+  
+  return constrain(1500 + offset, 1000, 2000);
+}
+
+///////////
+
+// Rate scales the whole curve (1.0 is RECEIVER_MAX_ANGLE at full stick)
+// Expo (0.0 to 1.0) softens the middle of the stick without changing the ends
+void Receiver::setCurve(float rate, float expo){
+  _rate = constrain(rate, 0.1, 2.0);
+  _expo = constrain(expo, 0.0, 1.0);
+  buildCurve();
+}
+
+float Receiver::getRate(){
+  return _rate;
+}
+
+float Receiver::getExpo(){
+  return _expo;
+}
+
+// Only runs when the curve changes, so the float math is fine here
+void Receiver::buildCurve(){
+  for (byte point = 0; point < RECEIVER_CURVE_POINTS; point++){
+    float x = (point * 32) / 500.0; // The last point is a little past full stick, so that full stick lands on the curve
+    float y = (x * (1 - _expo)) + (_expo * x * x * x);
+    curve[point] = y * _rate * RECEIVER_MAX_ANGLE * 100;
+  }
+}
+
+void Receiver::setSmoothFactor(float smoothFactor){
+  _smoothFactor = constrain(smoothFactor, 0.01, 1.0);
+}
+
+float Receiver::getSmoothFactor(){
+  return _smoothFactor;
+}
+
+///////////
+
+// Store calibration in the eeprom config. The curve and smoothing are parameters, see Parameters.pde
+void Receiver::save(){
+  for (byte i=0; i<CHANNELS; i++){
+    config.receiverCalibration[i][0] = calMin[i];
+    config.receiverCalibration[i][1] = calCenter[i];
+    config.receiverCalibration[i][2] = calMax[i];
+  }
+}
+
+// Load calibration from the eeprom config
+// Anything that doesn't look sane (like a blank eeprom) is left at the defaults
+void Receiver::load(){
+  for (byte i=0; i<CHANNELS; i++){
+    int low = config.receiverCalibration[i][0];
+    int center = config.receiverCalibration[i][1];
+    int high = config.receiverCalibration[i][2];
+    
+    if (low >= RECEIVER_MIN_PULSE && high <= RECEIVER_MAX_PULSE && center - low >= 100 && high - center >= 100){
+      calMin[i] = low;
+      calCenter[i] = center;
+      calMax[i] = high;
+      updateScale(i);
+    }
+  }
+}
+
+///////////
+
+// How long since this channel had a good pulse, in milliseconds
+unsigned long Receiver::getFrameAge(byte channel){
+  return millis() - lastFrame[channel];
+}
+
+// How long since we last heard from all of the sticks, in milliseconds
+// Gear and aux aren't needed to fly, so they don't count
+unsigned long Receiver::getFrameAge(){
+  unsigned long age = getFrameAge(THROTTLE_CHANNEL);
+  age = max(age, getFrameAge(ROLL_CHANNEL));
+  age = max(age, getFrameAge(PITCH_CHANNEL));
+  age = max(age, getFrameAge(YAW_CHANNEL));
+  return age;
+}
+
+// Have we lost the transmitter?
+boolean Receiver::isFailsafe(){
+  return _failsafe;
+}
+
+void Receiver::setFailsafeTimeout(unsigned int timeout){
+  _failsafeTimeout = timeout;
+}
+
+unsigned int Receiver::getFailsafeTimeout(){
+  return _failsafeTimeout;
 }
@@ -22,22 +22,70 @@
 #include "WProgram.h"
 #include "Definitions.h"
 
+#define RECEIVER_CURVE_POINTS 17 // 0-512us of stick deflection, in 32us steps
+
 class Receiver
 {
   public:
     Receiver();
+    void init();
     
     void updateAll();
     int getChannel(byte channel);
     float getSmoothedChannel(byte channel);
     float getAngle(byte channel);
     
+    unsigned long getFrameAge(byte channel);
+    unsigned long getFrameAge();
+    boolean isFailsafe();
+    
+    void setFailsafeTimeout(unsigned int);
+    unsigned int getFailsafeTimeout();
+    
+    void startCalibration();
+    void stopCalibration();
+    boolean isCalibrating();
+    int getMin(byte channel);
+    int getCenter(byte channel);
+    int getMax(byte channel);
+    
+    void setCurve(float, float);
+    float getRate();
+    float getExpo();
+    void setSmoothFactor(float);
+    float getSmoothFactor();
+    
+    void save();
+    void load();
+    
   private:
-    int channels[6]; // Channel-to-pin assignments
+    void resetCalibration();
+    void updateScale(byte channel);
+    int applyCalibration(byte channel, int);
+    void buildCurve();
+    
+    int channels[6]; // Channel-to-pin (or channel-to-frame-position) assignments
     int readings[6]; // Current values for the channels
     float smoothed[6]; // Current smoothed values for the channels
 
     float _smoothFactor; // Smoothing for all channels
+    
+    unsigned long lastFrame[6]; // When each channel last had a good pulse, in milliseconds
+    unsigned int _failsafeTimeout; // In milliseconds
+    boolean _failsafe;
+    
+    // Receiver endpoints, in microseconds. Scales are 1/65536ths of a microsecond of output per microsecond of input
+    int calMin[6];
+    int calCenter[6];
+    int calMax[6];
+    long scaleLow[6];
+    long scaleHigh[6];
+    boolean _calibrating;
+    
+    // Stick deflection to angle, in hundredths of a degree. One point per 32us of stick, see buildCurve()
+    int curve[RECEIVER_CURVE_POINTS];
+    float _rate;
+    float _expo;
 };
 
 #endif
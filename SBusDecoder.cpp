@@ -0,0 +1,108 @@
+/*
+  SBusDecoder.cpp - Library for decoding a Futaba S.BUS style serial RC receiver stream
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// A frame is 25 bytes at 100000 baud, 8E2, with the signal inverted (so it needs an inverter in front of the UART):
+//   0x0F, 22 bytes of 16 packed 11-bit channels (LSB first), a flags byte, and a footer byte
+//
+// There is no checksum, so the header and footer are all we have to stay in sync with.
+//
+
+#include "SBusDecoder.h"
+
+SBusDecoder::SBusDecoder(){
+  _index = 0;
+  _flags = SBUS_FLAG_FAILSAFE; // Until we hear otherwise
+  _errors = 0;
+  
+  for (uint8_t i=0; i<SBUS_CHANNELS; i++){
+    _channels[i] = 1500;
+  }
+}
+
+// Feed in one byte off the wire
+// Returns true if that completed a good frame
+bool SBusDecoder::push(uint8_t b){
+  if (_index == 0 && b != SBUS_HEADER) return false; // Still looking for the start of a frame
+  
+  _frame[_index++] = b;
+  if (_index < SBUS_FRAME_SIZE) return false;
+  
+  // Plain S.BUS ends in 0x00, S.BUS2 cycles the low nibble through 0x04
+  uint8_t footer = _frame[SBUS_FRAME_SIZE-1];
+  if (footer != 0x00 && (footer & 0x0F) != 0x04){
+    _errors++;
+    resync();
+    return false;
+  }
+  
+  decode();
+  _index = 0;
+  return true;
+}
+
+// We were out of step. Slide down to the next thing that looks like a header and carry on from there
+void SBusDecoder::resync(){
+  uint8_t start;
+  for (start = 1; start < SBUS_FRAME_SIZE; start++){
+    if (_frame[start] == SBUS_HEADER) break;
+  }
+  
+  _index = 0;
+  for (uint8_t i = start; i < SBUS_FRAME_SIZE; i++){
+    _frame[_index++] = _frame[i];
+  }
+}
+
+void SBusDecoder::decode(){
+  uint8_t byteIndex = 1;
+  uint8_t bitIndex = 0;
+  
+  for (uint8_t channel = 0; channel < SBUS_CHANNELS; channel++){
+    uint16_t value = 0;
+    
+    for (uint8_t bit = 0; bit < 11; bit++){
+      if (_frame[byteIndex] & (1 << bitIndex)) value |= (1 << bit);
+      
+      if (++bitIndex == 8){
+        bitIndex = 0;
+        byteIndex++;
+      }
+    }
+    
+    // 172-1811 is the usual range, which maps onto 988-2012us
+    _channels[channel] = ((value * 5) >> 3) + 880;
+  }
+  
+  _flags = _frame[23];
+}
+
+// In microseconds
+uint16_t SBusDecoder::getChannel(uint8_t channel){
+  return _channels[channel];
+}
+
+uint8_t SBusDecoder::getFlags(){
+  return _flags;
+}
+
+// How many frames have we thrown away?
+unsigned long SBusDecoder::getErrors(){
+  return _errors;
+}
@@ -0,0 +1,58 @@
+/*
+  SBusDecoder.h - Library for decoding a Futaba S.BUS style serial RC receiver stream
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef SBusDecoder_h
+#define SBusDecoder_h
+
+// No Arduino dependencies in here, so that the host tools can replay recorded streams through it
+#include <stdint.h>
+
+#define SBUS_BAUD 100000
+#define SBUS_FRAME_SIZE 25
+#define SBUS_CHANNELS 16
+#define SBUS_HEADER 0x0F
+
+#define SBUS_FLAG_FRAME_LOST 0x04 // The receiver missed a frame from the transmitter
+#define SBUS_FLAG_FAILSAFE 0x08 // The receiver has given up on the transmitter
+
+class SBusDecoder
+{
+  public:
+    SBusDecoder();
+    
+    bool push(uint8_t);
+    
+    uint16_t getChannel(uint8_t);
+    uint8_t getFlags();
+    
+    unsigned long getErrors();
+    
+  private:
+    void decode();
+    void resync();
+  
+    uint8_t _frame[SBUS_FRAME_SIZE];
+    uint8_t _index;
+    
+    uint16_t _channels[SBUS_CHANNELS]; // In microseconds
+    uint8_t _flags;
+    
+    unsigned long _errors;
+};
+
+#endif
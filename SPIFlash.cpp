@@ -0,0 +1,140 @@
+/*
+  SPIFlash.cpp - Library for talking to an SPI NOR flash chip (W25Q or anything with the same commands)
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include "WProgram.h"
+#include "SPIFlash.h"
+
+#define FLASH_WRITE_ENABLE 0x06
+#define FLASH_READ_STATUS 0x05
+#define FLASH_READ_DATA 0x03
+#define FLASH_PAGE_PROGRAM 0x02
+#define FLASH_SECTOR_ERASE 0x20
+#define FLASH_JEDEC_ID 0x9F
+
+#define FLASH_STATUS_BUSY 0x01
+
+// The hardware SPI pins on the Mega
+#define SPI_SS_PIN 53
+#define SPI_MOSI_PIN 51
+#define SPI_SCK_PIN 52
+
+SPIFlash::SPIFlash(byte csPin){
+  _csPin = csPin;
+  _size = 0;
+}
+
+void SPIFlash::init(){
+  digitalWrite(_csPin, HIGH);
+  pinMode(_csPin, OUTPUT);
+  
+  // SS has to be an output, or the SPI hardware drops out of master mode whenever it goes low
+  pinMode(SPI_SS_PIN, OUTPUT);
+  pinMode(SPI_MOSI_PIN, OUTPUT);
+  pinMode(SPI_SCK_PIN, OUTPUT);
+  
+  // Master, mode 0, 8MHz
+  SPCR = _BV(SPE) | _BV(MSTR);
+  SPSR = _BV(SPI2X);
+  
+  // The third byte of the ID is the capacity, as a power of 2. Nothing there reads as 0x00 or 0xFF
+  select();
+  transfer(FLASH_JEDEC_ID);
+  transfer(0); // Manufacturer
+  transfer(0); // Type
+  byte capacity = transfer(0);
+  deselect();
+  
+  if (capacity >= 16 && capacity <= 24) _size = 1UL << capacity;
+}
+
+// How many bytes the chip holds, 0 if we didn't find one
+uint32_t SPIFlash::getSize(){
+  return _size;
+}
+
+// Still programming or erasing?
+bool SPIFlash::isBusy(){
+  select();
+  transfer(FLASH_READ_STATUS);
+  byte status = transfer(0);
+  deselect();
+  
+  return status & FLASH_STATUS_BUSY;
+}
+
+void SPIFlash::read(uint32_t address, uint8_t *data, uint16_t length){
+  command(FLASH_READ_DATA, address);
+  for (uint16_t i=0; i<length; i++){
+    data[i] = transfer(0);
+  }
+  deselect();
+}
+
+// Chip select stays low until endProgram(), so the data can come in over several calls
+void SPIFlash::beginProgram(uint32_t address){
+  writeEnable();
+  command(FLASH_PAGE_PROGRAM, address);
+}
+
+void SPIFlash::program(const uint8_t *data, uint16_t length){
+  for (uint16_t i=0; i<length; i++){
+    transfer(data[i]);
+  }
+}
+
+// The chip starts programming when chip select goes back up
+void SPIFlash::endProgram(){
+  deselect();
+}
+
+void SPIFlash::eraseSector(uint32_t address){
+  writeEnable();
+  command(FLASH_SECTOR_ERASE, address);
+  deselect();
+}
+
+byte SPIFlash::transfer(byte b){
+  SPDR = b;
+  while (!(SPSR & _BV(SPIF)));
+  
+  return SPDR;
+}
+
+void SPIFlash::select(){
+  digitalWrite(_csPin, LOW);
+}
+
+void SPIFlash::deselect(){
+  digitalWrite(_csPin, HIGH);
+}
+
+// Select the chip and send a command with an address. Leaves the chip selected
+void SPIFlash::command(byte cmd, uint32_t address){
+  select();
+  transfer(cmd);
+  transfer(address >> 16);
+  transfer(address >> 8);
+  transfer(address);
+}
+
+void SPIFlash::writeEnable(){
+  select();
+  transfer(FLASH_WRITE_ENABLE);
+  deselect();
+}
@@ -0,0 +1,54 @@
+/*
+  SPIFlash.h - Library for talking to an SPI NOR flash chip (W25Q or anything with the same commands)
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef SPIFlash_h
+#define SPIFlash_h
+
+#include "WProgram.h"
+#include "FlashLog.h"
+
+class SPIFlash : public FlashChip
+{
+  public:
+    SPIFlash(byte csPin);
+    
+    void init();
+    
+    uint32_t getSize();
+    bool isBusy();
+    
+    void read(uint32_t address, uint8_t *data, uint16_t length);
+    
+    void beginProgram(uint32_t address);
+    void program(const uint8_t *data, uint16_t length);
+    void endProgram();
+    
+    void eraseSector(uint32_t address);
+    
+  private:
+    byte _csPin;
+    uint32_t _size;
+    
+    byte transfer(byte);
+    void select();
+    void deselect();
+    void command(byte, uint32_t);
+    void writeEnable();
+};
+
+#endif
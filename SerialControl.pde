@@ -22,116 +22,426 @@
 // Interop FTW.
 //
 
+//
+// Commands are a single letter, followed by however many ';'-terminated values that command takes, e.g. "M1.0;0.5;0.8;"
+// We take whatever bytes have arrived each time through the loop, and only act on a command once all of its values
+// are in, so nothing ever waits on the serial port and a command is never half-applied.
+//
+
+#define SERIAL_MAX_ARGS (PARAM_COUNT + 1) // Enough for 'u' to load every parameter
+#define SERIAL_ARG_SIZE 10
+
 byte _queryType;
 
+byte _command = 0; // The command we're collecting values for, 0 when waiting for a new one
+byte _argCount; // How many values it takes
+byte _argIndex; // How many we have
+byte _argRead; // How many readFloatSerial() has handed out
+float _args[SERIAL_MAX_ARGS];
+char _argChars[SERIAL_MAX_ARGS]; // The first character of each, for values that are letters
+char _argBuffer[SERIAL_ARG_SIZE];
+byte _argLength;
+unsigned long _commandTime; // When we last heard anything for _command, in milliseconds
+
+byte _paramID; // Which parameter 'p' asked for
+byte _paramLine; // How far through its lines 'r' is
+unsigned long _blackboxOffset; // How much of the blackbox 'l' has sent
+byte _benchmarkKernel; // Which kernel 'm' times next
+byte _memoryModule; // How far through its lines 'h' is
+
+// How many values follow each command letter
+byte serialArgCount(byte command){
+  switch (command){
+    case 'A': // Roll and pitch gyro PID, minAcro
+    case 'C': // Yaw and heading PID, headingHoldConfig
+      return 7;
+    case 'E': // Roll and pitch auto level PID
+      return 6;
+    case 'M': // rate;expo;smoothing
+    case 'K': // gyro smoothing;accel smoothing;time constant
+      return 3;
+    case 'G': // level limit;level off
+    case '+': // stream;rate;
+    case 'q': // id;value;
+      return 2;
+    case 'u': // count;, then that many values. See readSerialCommand()
+    case 'p':
+    case 'w':
+    case 'O':
+    case '3':
+    case '5':
+    case '$':
+    case 't':
+    case 's':
+    case 'x':
+    case '-':
+      return 1;
+  }
+  
+  return 0;
+}
+
 void readSerialCommand(){
-  // Check for serial message
-  if (Serial.available()){
-    _queryType = Serial.read(); // Read the command first
-
-    switch (_queryType){
-      case 'A': // TODO: Receive roll and pitch gyro PID
-        //readSerialPID(ROLL);
-        //readSerialPID(PITCH);
-        //float minAcro = readFloatSerial();
-        break;
-      case 'C': // TODO: Receive yaw PID
-        /*readSerialPID(YAW);
-        readSerialPID(HEADING);
-        headingHoldConfig = readFloatSerial();
-        heading = 0;
-        relativeHeading = 0;
-        headingHold = 0;*/
-        break;
-      case 'E': // TODO: Receive roll and pitch auto level PID
-        readSerialPID(levelRollPID);
-        readSerialPID(levelPitchPID);
-        //readSerialPID(LEVELGYROROLL);
-        //readSerialPID(LEVELGYROPITCH);
-        //windupGuard = readFloatSerial(); // defaults found in setup() of AeroQuad.pde
-        break;
-      case 'G': // Receive auto level configuration
-        break;
-      case 'I': // Receive altitude hold PID
-        break;
-      case 'K': // Receive data filtering values
-        break;
-      case 'M': // Receive transmitter smoothing values
-        break;
-      case 'O': // Receive transmitter calibration values
-        break;
-      case 'W': // Write all user configurable values to EEPROM
-        eeprom_write_all();
-        break;
-      case 'Y': // Initialize EEPROM with default values
-        eeprom_read_all();
-        break;
-      case '1': // Calibrate ESCS's by setting Throttle high on all channels
-        engines.disarm();
-        engines.arm(1);
-        break;
-      case '2': // Calibrate ESC's by setting Throttle low on all channels
-        engines.disarm();
-        engines.arm(2);
-        break;
-      case '3': // Test ESC calibration
-        engines.disarm();
-        engines.setThrottle(constrain(readFloatSerial(), 1000, 1200));
-        break;
-      case '4': // Turn off ESC calibration
-        engines.disarm();
-        break;
-      case '5': // Send individual motor commands (motor, command)
-        engines.disarm();
-        engines.setThrottle(constrain(readFloatSerial(), 1000, 1200));
-        // HOW DOES THIS DIFFER FROM 3!?
-        break;
-      case 'a': // fast telemetry transfer
-        // IGNORED
-        break;
-      case 'b': // calibrate gyros
-        gyro.autoZero();
-        break;
-      case 'c': // calibrate accels
-        accel.autoZero();
-        break;
-      case 'd': // send aref
-        // IGNORED
-        break;
-      case 'f': // calibrate magnetometer
-        // IGNORED
-        break;
-      case '~': // read Camera values 
-        // IGNORED
-        break;
+  // Whatever we were in the middle of has gone stale, forget it
+  if (_command && millis() - _commandTime > SERIAL_COMMAND_TIMEOUT){
+    _command = 0;
+  }
+  
+  while (Serial.available()){
+    byte data = Serial.read();
+    
+    if (!_command){
+      if (data == '\r' || data == '\n') continue; // Line endings from a serial monitor aren't commands
       
-      // The following modes are my own
-      case '$': // Set throttle
-        engines.setThrottle(readIntSerial());
-        break;
-      case 's': // Set system mode
-        systemMode = readIntSerial();
-        _queryType = 'X';
-        break;
+      _command = data;
+      _argCount = serialArgCount(data);
+      _argIndex = 0;
+      _argLength = 0;
+    }
+    else if (data == ';'){
+      _argBuffer[_argLength] = '\0';
+      _argChars[_argIndex] = _argBuffer[0];
+      _args[_argIndex++] = atof(_argBuffer);
+      _argLength = 0;
+      
+      // A bulk load says how many values are coming
+      if (_command == 'u' && _argIndex == 1) _argCount = 1 + constrain((int)_args[0], 0, PARAM_COUNT);
+    }
+    else if (_argLength < SERIAL_ARG_SIZE-1){
+      _argBuffer[_argLength++] = data;
+    }
+    
+    _commandTime = millis();
+    
+    if (_argIndex == _argCount){
+      applySerialCommand(_command);
+      _command = 0;
     }
   }
 }
 
-void sendSerialTelemetry(){
+// Everything the command needs has arrived, now do it
+void applySerialCommand(byte command){
+  _argRead = 0;
+  
+  // Subscriptions run alongside the AeroQuad query, so they leave _queryType alone
+  if (command == '+'){
+    byte stream = readCharSerial();
+    subscribeSerialStream(stream, readIntSerial());
+    return;
+  }
+  if (command == '-'){
+    subscribeSerialStream(readCharSerial(), 0);
+    return;
+  }
+  
+  _queryType = command;
+  
   switch (_queryType){
+    case 'A': // TODO: Receive roll and pitch gyro PID
+      //readSerialPID(ROLL);
+      //readSerialPID(PITCH);
+      for (byte i=0; i<6; i++) readFloatSerial(); // No gyro PIDs yet, so only minAcro is kept
+      setParameter(PARAM_MIN_ACRO, readFloatSerial());
+      break;
+    case 'C': // TODO: Receive yaw PID
+      /*readSerialPID(YAW);
+      readSerialPID(HEADING);
+      headingHoldConfig = readFloatSerial();
+      heading = 0;
+      relativeHeading = 0;
+      headingHold = 0;*/
+      break;
+    case 'E': // TODO: Receive roll and pitch auto level PID
+      readSerialPID(PARAM_LEVEL_ROLL_P);
+      readSerialPID(PARAM_LEVEL_PITCH_P);
+      //readSerialPID(LEVELGYROROLL);
+      //readSerialPID(LEVELGYROPITCH);
+      //windupGuard = readFloatSerial(); // defaults found in setup() of AeroQuad.pde
+      break;
+    case 'G': // Receive auto level configuration
+      setParameter(PARAM_LEVEL_LIMIT, readFloatSerial());
+      setParameter(PARAM_LEVEL_OFF, readFloatSerial());
+      break;
+    case 'I': // Receive altitude hold PID
+      break;
+    case 'K': // Receive data filtering values
+      setParameter(PARAM_GYRO_SMOOTH, readFloatSerial());
+      setParameter(PARAM_ACCEL_SMOOTH, readFloatSerial());
+      setParameter(PARAM_TIME_CONSTANT, readFloatSerial());
+      break;
+    case 'M': // Receive transmitter smoothing values: rate;expo;smoothing;
+      {
+        float rate = readFloatSerial();
+        float expo = readFloatSerial();
+        receiver.setCurve(rate, expo);
+        receiver.setSmoothFactor(readFloatSerial());
+      }
+      break;
+    case 'O': // Transmitter calibration: 1 to start (sticks centered), 0 to finish and store (after moving everything to its limits)
+      if (readIntSerial()){
+        receiver.startCalibration();
+      }
+      else if (receiver.isCalibrating()){
+        receiver.stopCalibration();
+        saveConfig(false);
+      }
+      break;
+    case 'W': // Write all user configurable values to EEPROM
+      saveConfig(false);
+      break;
+    case 'Y': // Initialize EEPROM with default values
+      resetParameters();
+      saveConfig(false);
+      break;
+    case '1': // Calibrate ESCS's by setting Throttle high on all channels
+      engines.disarm();
+      engines.arm(1);
+      break;
+    case '2': // Calibrate ESC's by setting Throttle low on all channels
+      engines.disarm();
+      engines.arm(2);
+      break;
+    case '3': // Test ESC calibration
+      engines.disarm();
+      engines.setThrottle(constrain(readFloatSerial(), 1000, 1200));
+      break;
+    case '4': // Turn off ESC calibration
+      engines.disarm();
+      break;
+    case '5': // Send individual motor commands (motor, command)
+      engines.disarm();
+      engines.setThrottle(constrain(readFloatSerial(), 1000, 1200));
+      // HOW DOES THIS DIFFER FROM 3!?
+      break;
+    case 'a': // fast telemetry transfer: binary frames, see sendBinaryTelemetry()
+      break;
+    case 'b': // calibrate gyros
+      gyro.autoZero();
+      break;
+    case 'c': // calibrate accels
+      accel.autoZero();
+      saveConfig(false);
+      break;
+    case 'd': // send aref
+      // IGNORED
+      break;
+    case 'f': // calibrate magnetometer
+      // IGNORED
+      break;
+    case '~': // read Camera values 
+      // IGNORED
+      break;
+    
+    // The following modes are my own
+    case '$': // Set throttle
+      engines.setThrottle(readIntSerial());
+      break;
+    case 'p': // Get a parameter: id;
+      _paramID = readIntSerial();
+      break;
+    case 'q': // Set a parameter: id;value;
+      {
+        byte id = readIntSerial();
+        setParameter(id, readFloatSerial());
+      }
+      break;
+    case 'u': // Set parameters 0 through count-1 all at once: count;value;value;...
+      {
+        byte count = readIntSerial();
+        for (byte id = 0; id < count; id++){
+          setParameter(id, readFloatSerial());
+        }
+      }
+      break;
+    case 'l': // Dump the blackbox
+      _blackboxOffset = 0;
+      break;
+    case 'k': // Erase the blackbox, only while disarmed
+      if (!engines.isArmed()) blackbox.erase();
+      break;
+    case 'm': // Run the microbenchmarks, only while disarmed
+      _benchmarkKernel = 0;
+      break;
+    case 'h': // Report RAM use
+      _memoryModule = 0;
+      break;
+    case 'r': // Send every parameter
+      _paramLine = 0;
+      break;
+    case 'w': // EEPROM status, and 1 to store everything now, even while armed
+      if (readIntSerial()) saveConfig(true);
+      break;
+    case 'x': // Set the serial transmit budget, in bytes per loop
+      serialTX.setBudget(readIntSerial());
+      break;
+    case 't': // Set receiver failsafe timeout, in milliseconds
+      receiver.setFailsafeTimeout(readIntSerial());
+      break;
+    case 's': // Set system mode
+      systemMode = readIntSerial();
+      if (systemMode == 3) autotune.stop(); // Start tuning fresh
+      _queryType = 'X';
+      break;
+  }
+}
+
+//
+// Subscriptions: besides the one AeroQuad style query, a ground station can ask for several streams at once, each at
+// its own rate, e.g. "+&;50;" for '&' at 50Hz, "+a;10;" for binary frames at 10Hz, "-&;" to stop it, "-*;" to stop all.
+//
+// Each line of a subscribed ASCII stream starts with the stream's letter and a comma, so they can be told apart.
+// Streams that are due are sent round robin, as many as fit in this loop's budget. One that doesn't fit stays due,
+// and the others wait until it has gone, so a big stream can't be starved by small ones.
+//
+
+byte _streamType[SERIAL_STREAMS]; // 0 if the slot is free
+unsigned long _streamInterval[SERIAL_STREAMS]; // Microseconds between sends
+unsigned long _streamTime[SERIAL_STREAMS]; // When it's next due
+byte _streamLength[SERIAL_STREAMS]; // How many bytes its last frame took, or at least how many it needs
+byte _streamNext = 0; // Where the round robin starts
+
+// The queries that make sense to send over and over
+boolean isSerialStream(byte stream){
+  switch (stream){
+    case 'Q':
+    case 'S':
+    case 'T':
+    case 'U':
+    case 'V':
+    case 'Z':
+    case '6':
+    case '&':
+    case 'a':
+      return true;
+  }
+  
+  return false;
+}
+
+// rate is in Hz, 0 to unsubscribe
+void subscribeSerialStream(byte stream, int rate){
+  for (byte i = 0; i < SERIAL_STREAMS; i++){
+    if (stream == '*' || _streamType[i] == stream) _streamType[i] = 0;
+  }
+  
+  if (rate <= 0 || !isSerialStream(stream)) return;
+  
+  for (byte i = 0; i < SERIAL_STREAMS; i++){
+    if (_streamType[i]) continue;
+    
+    _streamType[i] = stream;
+    _streamInterval[i] = max(1000000L / rate, SERIAL_RATE);
+    _streamTime[i] = currentTime;
+    _streamLength[i] = 0;
+    return;
+  }
+}
+
+void sendSerialTelemetry(){
+  byte queryType = _queryType;
+  byte paramLine = _paramLine;
+  byte memoryModule = _memoryModule;
+  byte benchmarkKernel = _benchmarkKernel;
+  
+  serialTX.beginFrame();
+  sendSerialQuery(queryType);
+  
+  // A reply that didn't fit is still owed, unlike a stream that will send a fresh line next time. Put back the query,
+  // and how far through its lines it was, and hold the streams back so the space goes to it
+  if (!serialTX.endFrame() && !isSerialStream(queryType)){
+    _queryType = queryType;
+    _paramLine = paramLine;
+    _memoryModule = memoryModule;
+    _benchmarkKernel = benchmarkKernel;
+    return;
+  }
+  
+  byte first = _streamNext;
+  
+  for (byte i = 0; i < SERIAL_STREAMS; i++){
+    byte slot = (first + i) % SERIAL_STREAMS;
+    if (!_streamType[slot] || (long)(currentTime - _streamTime[slot]) < 0) continue;
+    
+    // Out of room. This one goes first next time, and the rest wait behind it so they can't use up the space it needs.
+    // Its last frame says whether it can fit, so we don't format one (floats and all) only to throw it away
+    if (serialTX.getFree() < _streamLength[slot]){
+      _streamNext = slot;
+      break;
+    }
+    
+    serialTX.beginFrame();
+    if (_streamType[slot] != 'a'){
+      serialTX.print((char)_streamType[slot]);
+      serialComma();
+    }
+    sendSerialQuery(_streamType[slot]);
+    
+    byte length = serialTX.getFrameLength();
+    if (!serialTX.endFrame()){
+      _streamLength[slot] = min(length + 1, 255); // It grew. All we know is that it needs more than there was
+      _streamNext = slot;
+      break;
+    }
+    _streamLength[slot] = length;
+    
+    // If we've fallen more than a whole interval behind, don't try to catch up
+    _streamTime[slot] += _streamInterval[slot];
+    if ((long)(currentTime - _streamTime[slot]) > 0) _streamTime[slot] = currentTime + _streamInterval[slot];
+    
+    _streamNext = (slot + 1) % SERIAL_STREAMS;
+  }
+}
+
+//
+// What each module keeps in RAM, for 'h'. That's only the objects themselves: statics inside a .cpp (like the
+// buffers in SerialTX.cpp) are only in the total. "rake memory" or "make memory" breaks that down by object file.
+//
+struct ModuleSize {
+  char name[10];
+  unsigned int size;
+};
+
+const ModuleSize moduleSizes[] PROGMEM = {
+  {"gyro", sizeof(gyro)},
+  {"accel", sizeof(accel)},
+  {"baro", sizeof(baro)},
+  {"mag", sizeof(mag)},
+  {"imu", sizeof(imu)},
+  {"ins", sizeof(ins)},
+  {"engines", sizeof(engines)},
+  {"receiver", sizeof(receiver)},
+  {"battery", sizeof(battery)},
+  {"autotune", sizeof(autotune)},
+#if BLACKBOX_FLASH
+  {"blackbox", sizeof(blackbox) + sizeof(flashLog) + sizeof(flash)},
+#else
+  {"blackbox", sizeof(blackbox) + sizeof(blackboxBuffer)},
+#endif
+  {"serialTX", sizeof(serialTX)},
+  {"pids", sizeof(levelRollPID) + sizeof(levelPitchPID) + sizeof(headingHoldPID)},
+  {"mixer", sizeof(mixer)},
+  {"config", sizeof(config)},
+  {"serial", sizeof(_args) + sizeof(_argChars) + sizeof(_argBuffer) + sizeof(_streamType) + sizeof(_streamInterval) + sizeof(_streamTime) + sizeof(_streamLength)},
+};
+
+#define MODULE_COUNT (sizeof(moduleSizes) / sizeof(moduleSizes[0]))
+
+void sendSerialQuery(byte queryType){
+  switch (queryType){
     case '=': // Reserved debug command to view any variable from Serial Monitor
       //_queryType = 'X';
       break;
     case 'B': // Send roll and pitch gyro PID values
       //serialPrintPID(ROLL);
       //serialPrintPID(PITCH);
-      Serial.println(1300); // TODO: Read from EEPROM
+      serialTX.println(minAcro);
       _queryType = 'X';
       break;
     case 'D': // Send yaw PID values
       //serialPrintPID(YAW);
       serialPrintPID(headingHoldPID);
-      Serial.println(0, BIN);
+      serialTX.println(0, BIN);
       _queryType = 'X';
       break;
     case 'F': // Send roll and pitch auto level PID values
@@ -145,12 +455,12 @@ void sendSerialTelemetry(){
       serialPrintValueComma(0.00);
       serialPrintValueComma(0.00);
       serialPrintValueComma(0.00);
-      Serial.println(WINDUP_GUARD_GAIN); // TODO: windup guard
+      serialTX.println(WINDUP_GUARD_GAIN); // TODO: windup guard
       _queryType = 'X';
       break;
     case 'H': // Send auto level configuration values
-      serialPrintValueComma(500.0); // TODO: Read this from EEPROM
-      Serial.println(150.0); // TODO: Read this from EEPROM
+      serialPrintValueComma(levelLimit);
+      serialTX.println(levelOff);
     
       _queryType = 'X';
       break;
@@ -158,46 +468,34 @@ void sendSerialTelemetry(){
       for(byte i=0; i<9; i++) {
         serialPrintValueComma(0);
       }
-      Serial.println('0');
+      serialTX.println('0');
     
       _queryType = 'X';
       break;
     case 'L': // Send data filtering values
-      serialPrintValueComma(1.0);
+      serialPrintValueComma(gyroSmoothFactor);
       serialPrintValueComma(accel.getSmoothFactor());
-      Serial.println(7.0); // TODO: Read this from EEPROM
+      serialTX.println(timeConstant);
       _queryType = 'X';
       break;
     case 'N': // Send transmitter smoothing values
-      serialPrintValueComma(0); // TODO? receiver transmit factor
-      
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      Serial.println(0.0); // TODO?
+      serialPrintValueComma(receiver.getRate());
+      serialPrintValueComma(receiver.getExpo());
+      serialTX.println(receiver.getSmoothFactor());
       
       _queryType = 'X';
       break;
-    case 'P': // Send transmitter calibration data
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      
-      serialPrintValueComma(0.0); // TODO?
-      serialPrintValueComma(0.0); // TODO?
-      
-      serialPrintValueComma(0.0); // TODO?
-      Serial.println(0.0); // TODO?
+    case 'P': // Send transmitter calibration data: min, center, max for each channel
+      for (byte channel = 0; channel < CHANNELS; channel++){
+        serialPrintValueComma(receiver.getMin(channel));
+        serialPrintValueComma(receiver.getCenter(channel));
+        if (channel < CHANNELS-1){
+          serialPrintValueComma(receiver.getMax(channel));
+        }
+        else{
+          serialTX.println(receiver.getMax(channel));
+        }
+      }
       
       _queryType = 'X';
       break;
@@ -216,7 +514,7 @@ void sendSerialTelemetry(){
       
       serialPrintValueComma(imu.getRoll());
       serialPrintValueComma(imu.getPitch());
-      Serial.println(imu.getHeading());
+      serialTX.println(imu.getHeading());
       break;
     case 'R': // *** Spare ***
       break;
@@ -233,12 +531,12 @@ void sendSerialTelemetry(){
 
       serialPrintValueComma(battery.getData()); // Battery monitor
       
-      serialPrintValueComma(0); // TODO: Motor axis commands
-      serialPrintValueComma(0); // TODO: Motor axis commands
-      serialPrintValueComma(0); // TODO: Motor axis commands
-      serialPrintValueComma(0); // TODO: Motor axis commands
+      serialPrintValueComma(mixer.getRoll()); // Motor axis commands
+      serialPrintValueComma(mixer.getPitch());
+      serialPrintValueComma(mixer.getYaw());
+      serialPrintValueComma(mixer.getThrottle());
       
-      Serial.print(engines.isArmed(), BIN);
+      serialTX.print(engines.isArmed(), BIN);
       serialComma();
 
       serialPrintValueComma(2000); // Always stable mode
@@ -246,7 +544,7 @@ void sendSerialTelemetry(){
       serialPrintValueComma(imu.getHeading()); // Heading
       
       serialPrintValueComma(baro.getRawAltitude()); // Alt hold data
-      Serial.println(0); // Alt hold on
+      serialTX.println(0); // Alt hold on
       break;
     case 'T': // Send processed transmitter values
       serialPrintValueComma(0); // TODO? receiver transmit factor
@@ -258,18 +556,18 @@ void sendSerialTelemetry(){
       serialPrintValueComma(0.0); // TODO? level adjust roll
       serialPrintValueComma(0.0); // TODO? level adjust pitch
       
-      serialPrintValueComma(0); // TODO: motor axis roll
-      serialPrintValueComma(0); // TODO: motor axis pitch
-      Serial.println(0); // TODO: motor axis yaw
+      serialPrintValueComma(mixer.getRoll()); // Motor axis roll
+      serialPrintValueComma(mixer.getPitch()); // Motor axis pitch
+      serialTX.println(mixer.getYaw()); // Motor axis yaw
       
       break;
     case 'U': // Send smoothed receiver with Transmitter Factor applied values
-      serialPrintValueComma(0); // TODO?
-      serialPrintValueComma(0); // TODO?
-      serialPrintValueComma(0); // TODO?
-      serialPrintValueComma(0); // TODO?
-      serialPrintValueComma(0); // TODO?
-      Serial.println(0); // TODO?
+      serialPrintValueComma(receiver.getAngle(ROLL_CHANNEL));
+      serialPrintValueComma(receiver.getAngle(PITCH_CHANNEL));
+      serialPrintValueComma(receiver.getAngle(YAW_CHANNEL));
+      serialPrintValueComma(receiver.getSmoothedChannel(THROTTLE_CHANNEL));
+      serialPrintValueComma(receiver.getSmoothedChannel(GEAR_CHANNEL));
+      serialTX.println(receiver.getSmoothedChannel(AUX_CHANNEL));
       break;
     case 'V': // Send receiver status
       serialPrintValueComma(receiver.getChannel(ROLL_CHANNEL));
@@ -277,7 +575,8 @@ void sendSerialTelemetry(){
       serialPrintValueComma(receiver.getChannel(YAW_CHANNEL));
       serialPrintValueComma(receiver.getChannel(THROTTLE_CHANNEL));
       serialPrintValueComma(receiver.getChannel(GEAR_CHANNEL));
-      Serial.println(receiver.getChannel(AUX_CHANNEL));
+      serialPrintValueComma(receiver.getChannel(AUX_CHANNEL));
+      serialTX.println(receiver.getFrameAge()); // Milliseconds since we last heard the sticks
       break;
     case 'X': // Stop sending messages
       break;
@@ -285,26 +584,29 @@ void sendSerialTelemetry(){
       serialPrintValueComma(0); // TODO: receiver.getData(YAW)
       serialPrintValueComma(0.0); // TODO: headingHold
       serialPrintValueComma(0.0); // TODO: setHeading
-      Serial.println(0.0); // TODO: relativeHeading
+      serialTX.println(0.0); // TODO: relativeHeading
       break;
     case '6': // Report remote commands
       for (byte engine = 0; engine < ENGINE_COUNT-1; engine++){
         serialPrintValueComma(engines.getEngineSpeed(engine)); // TODO: These should be "remote commands"
       }
-      Serial.println(engines.getEngineSpeed(ENGINE_COUNT-1)); // TODO: These should be "remote commands"
+      serialTX.println(engines.getEngineSpeed(ENGINE_COUNT-1)); // TODO: These should be "remote commands"
       break;
     case '!': // Send flight software version
-      Serial.println(VERSION, 1);
+      serialTX.println(VERSION, 1);
       _queryType = 'X';
       break;
     case '#': // Send software configuration
       serialPrintValueComma(2); // Emulate AeroQuad_v18
-      Serial.print('1'); // X-config
-      Serial.println();
+      serialTX.print(FRAME_TYPE == FRAME_PLUS ? '0' : '1'); // X-config
+      serialTX.println();
       _queryType = 'X';
       break;  
+    case 'a': // Fast telemetry transfer
+      sendBinaryTelemetry();
+      break;
     case 'e': // Send AREF value
-      Serial.println(5.0);
+      serialTX.println(5.0);
       _queryType = 'X';
       break;
     case 'g': // Send magnetometer cal values
@@ -316,6 +618,108 @@ void sendSerialTelemetry(){
       break;
     
     // The following modes are my own
+    case 'p': // Send one parameter: id, type, min, max, default, value
+      if (_paramID < PARAM_COUNT){
+        Parameter param;
+        memcpy_P(&param, &parameters[_paramID], sizeof(param));
+        
+        serialPrintValueComma((int)_paramID);
+        serialPrintValueComma((int)param.type);
+        serialPrintValueComma(param.min);
+        serialPrintValueComma(param.max);
+        serialPrintValueComma(param.def);
+        serialTX.println(getParameter(_paramID), 4);
+      }
+      else{
+        serialTX.println(-1);
+      }
+      _queryType = 'X';
+      break;
+    case 'r': // Send every parameter: the count, then a line a loop of id,value in ID order. Ints go without decimals
+      if (!_paramLine){
+        serialTX.println(PARAM_COUNT);
+      }
+      else{
+        byte id = _paramLine - 1;
+        serialPrintValueComma((int)id);
+        serialTX.println(getParameter(id), pgm_read_byte(&parameters[id].type) == PARAM_INT ? 0 : 4);
+      }
+      
+      if (++_paramLine > PARAM_COUNT) _queryType = 'X';
+      break;
+    case 'l': // Send the blackbox, a piece at a time
+      if (sendBlackboxChunk()) _queryType = 'X';
+      break;
+    case 'h': // Send free RAM, peak stack, statics, total RAM and how many modules, then a line a loop of name,bytes for each
+      if (!_memoryModule){
+        serialPrintValueComma((unsigned long)memoryFree());
+        serialPrintValueComma((unsigned long)memoryStackPeak());
+        serialPrintValueComma((unsigned long)memoryStatic());
+        serialPrintValueComma((unsigned long)memorySize());
+        serialTX.println((int)MODULE_COUNT);
+      }
+      else{
+        ModuleSize module;
+        memcpy_P(&module, &moduleSizes[_memoryModule - 1], sizeof(module));
+        serialTX.print(module.name);
+        serialComma();
+        serialTX.println(module.size);
+      }
+      
+      if (++_memoryModule > MODULE_COUNT) _queryType = 'X';
+      break;
+    case 'm': // Time one kernel a loop, CSV with a header: kernel,calls,per_call,unit
+      if (engines.isArmed()){
+        _queryType = 'X';
+        break;
+      }
+      
+      if (!_benchmarkKernel) serialTX.println("kernel,calls,per_call,unit");
+      {
+        char name[BENCHMARK_NAME_LENGTH];
+        benchmarkName(_benchmarkKernel, name);
+        serialTX.print(name);
+        serialComma();
+        serialPrintValueComma((unsigned long)BENCHMARK_CALLS);
+        serialTX.print(benchmarkRun(_benchmarkKernel, BENCHMARK_CALLS), 1);
+        serialComma();
+        serialTX.println(BENCHMARK_UNIT);
+      }
+      
+      if (++_benchmarkKernel == BENCHMARK_COUNT) _queryType = 'X';
+      break;
+    case 'w': // Send EEPROM status: 1 if writing, bytes left to check, 1 if a save is waiting for us to disarm
+      serialPrintValueComma((int)eeprom_busy());
+      serialPrintValueComma(eeprom_pending());
+      serialTX.println((int)configWaiting);
+      _queryType = 'X';
+      break;
+    case 'n': // Measure one '&' line and one 'a' frame without sending them, only while disarmed: bytes,time for each, then the unit
+      if (!engines.isArmed()){
+        byte start = serialTX.getFrameLength();
+        
+        unsigned long asciiTime = benchmarkTime(sendAsciiTelemetry);
+        byte asciiBytes = serialTX.getFrameLength() - start;
+        if (!serialTX.rollbackFrame(start)) asciiBytes = 0; // It didn't fit, so we don't know
+        
+        unsigned long binaryTime = benchmarkTime(sendBinaryTelemetry);
+        byte binaryBytes = serialTX.getFrameLength() - start;
+        if (!serialTX.rollbackFrame(start)) binaryBytes = 0;
+        
+        serialPrintValueComma((int)asciiBytes);
+        serialPrintValueComma(asciiTime);
+        serialPrintValueComma((int)binaryBytes);
+        serialPrintValueComma(binaryTime);
+        serialTX.println(BENCHMARK_UNIT);
+      }
+      _queryType = 'X';
+      break;
+    case '%': // Send serial link status: bytes queued, budget per loop, frames dropped
+      serialPrintValueComma(serialTX.getQueued());
+      serialPrintValueComma(serialTX.getBudget());
+      serialTX.println(serialTX.getDropped());
+      _queryType = 'X';
+      break;
     case '&':
       serialPrintValueComma(deltaTime);
       serialPrintValueComma(imu.getRoll());
@@ -336,6 +740,7 @@ void sendSerialTelemetry(){
       
       serialPrintValueComma(baro.getRawAltitude());
       serialPrintValueComma(battery.getData());
+      serialPrintValueComma(mixer.getCompensation());
 
       serialPrintValueComma(engines.getThrottle());
       
@@ -344,85 +749,126 @@ void sendSerialTelemetry(){
       }
       
       serialPrintValueComma(engines.isArmed());
-      Serial.println(systemMode, DEC);
+      serialTX.print(systemMode, DEC);
+      serialComma();
+      serialTX.println(telemetryTime);
       
       break;
   }
 }
 
-// Used to read floating point values from the serial port
+// The '&' stream as a line of text, for 'n' to time
+void sendAsciiTelemetry(){
+  sendSerialQuery('&');
+}
+
+// The '&' stream as one fixed-layout binary frame: a fraction of the bytes, and no float formatting
+void sendBinaryTelemetry(){
+  TelemetryFlight record;
+  byte frame[sizeof(record) + TELEMETRY_OVERHEAD];
+  
+  record.deltaTime = deltaTime;
+  record.roll = imu.getRoll() * 100;
+  record.pitch = imu.getPitch() * 100;
+  record.heading = imu.getHeading() * 100;
+  
+  record.accelAngle[0] = accel.getXAngle() * 100;
+  record.accelAngle[1] = accel.getYAngle() * 100;
+  record.accelAngle[2] = accel.getZAngle() * 100;
+  
+  // The gyro is in radians/second, but 0.01 of those is too coarse. Past 327 degrees/second, it saturates
+  record.gyro[0] = constrain(degrees(gyro.getRoll()) * 100, -32767, 32767);
+  record.gyro[1] = constrain(degrees(gyro.getPitch()) * 100, -32767, 32767);
+  record.gyro[2] = constrain(degrees(gyro.getYaw()) * 100, -32767, 32767);
+  
+  record.mag[0] = mag.getRaw(XAXIS);
+  record.mag[1] = mag.getRaw(YAXIS);
+  record.mag[2] = mag.getRaw(ZAXIS);
+  
+  record.altitude = baro.getRawAltitude() * 100;
+  record.battery = battery.getData() * 1000;
+  record.compensation = mixer.getCompensation() * 1000;
+  
+  record.throttle = engines.getThrottle();
+  for (byte engine = 0; engine < 6; engine++){
+    record.engines[engine] = engine < ENGINE_COUNT ? engines.getEngineSpeed(engine) : 0;
+  }
+  
+  record.armed = engines.isArmed();
+  record.mode = systemMode;
+  record.telemetryTime = min(telemetryTime, 65535UL);
+  
+  byte length = telemetryEncode(TELEMETRY_FLIGHT, &record, sizeof(record), frame);
+  serialTX.write(frame, length);
+}
+
+// Send the next piece of the blackbox as a TELEMETRY_BLACKBOX frame, if there's room for it this time around
+// Nothing is recorded while armed, so the dump is empty until we disarm
+// Returns true once the end has gone out
+boolean sendBlackboxChunk(){
+  TelemetryBlackbox header;
+  byte payload[sizeof(header) + TELEMETRY_BLACKBOX_CHUNK];
+  byte frame[sizeof(payload) + TELEMETRY_OVERHEAD];
+  
+  header.offset = _blackboxOffset;
+  header.total = blackbox.isFrozen() ? blackbox.getLength() : 0;
+  if (header.offset > header.total) header.offset = header.total;
+  
+  byte length = min(header.total - header.offset, (unsigned long)TELEMETRY_BLACKBOX_CHUNK);
+  if (serialTX.getFree() < (int)(sizeof(header) + length + TELEMETRY_OVERHEAD)) return false;
+  
+  memcpy(payload, &header, sizeof(header));
+  if (!blackbox.read(header.offset, payload + sizeof(header), length)) return false; // Flash still busy, next time
+  
+  serialTX.write(frame, telemetryEncode(TELEMETRY_BLACKBOX, payload, sizeof(header) + length, frame));
+  _blackboxOffset = header.offset + length;
+  
+  return length == 0;
+}
+
+// The next value that came with the command being applied
 float readFloatSerial(){
-  #define SERIALFLOATSIZE 10
-  byte index = 0;
-  byte timeout = 0;
-  char data[SERIALFLOATSIZE] = "";
-
-  do {
-    if (Serial.available() == 0) {
-      delay(10);
-      timeout++;
-    }
-    else {
-      data[index] = Serial.read();
-      timeout = 0;
-      index++;
-    }
-  }  
-  while ((index == 0 || data[index-1] != ';') && (timeout < 5) && (index < sizeof(data)-1));
-  data[index] = '\0';
-  return atof(data);
+  if (_argRead >= _argIndex) return 0;
+  return _args[_argRead++];
 }
 
-// Used to read integer values from the serial port
 int readIntSerial(){
-  #define SERIALINTSIZE 7
-  byte index = 0;
-  byte timeout = 0;
-  char data[SERIALINTSIZE] = "";
-
-  do {
-    if (Serial.available() == 0) {
-      delay(10);
-      timeout++;
-    }
-    else {
-      data[index] = Serial.read();
-      timeout = 0;
-      index++;
-    }
-  }  
-  while ((index == 0 || data[index-1] != ';') && (timeout < 5) && (index < sizeof(data)-1));
-  data[index] = '\0';
-  return atoi(data);
+  return readFloatSerial();
+}
+
+// For values that are a letter rather than a number
+char readCharSerial(){
+  if (_argRead >= _argIndex) return 0;
+  return _argChars[_argRead++];
 }
 
 void serialPrintValueComma(float val){
-  Serial.print(val);
+  serialTX.print(val);
   serialComma();
 }
 
 void serialPrintValueComma(double val){
-  Serial.print(val);
+  serialTX.print(val);
   serialComma();
 }
 
 void serialPrintValueComma(char val){
-  Serial.print(val);
+  serialTX.print(val);
   serialComma();
 }
 
 void serialPrintValueComma(int val){
-  Serial.print(val);
+  serialTX.print(val);
   serialComma();
 }
 
 void serialPrintValueComma(unsigned long val){
-  Serial.print(val);
+  serialTX.print(val);
   serialComma();
 }
 
 void serialComma(){
-  Serial.print(',');
+  serialTX.print(',');
 }
 
 void serialPrintPID(PID pid){
@@ -431,8 +877,9 @@ void serialPrintPID(PID pid){
   serialPrintValueComma(pid.getD());
 }
 
-void readSerialPID(PID &pid) {
-  pid.setP(readFloatSerial());
-  pid.setI(readFloatSerial());
-  pid.setD(readFloatSerial());
+// P, I and D, into the parameter with this ID and the two after it
+void readSerialPID(byte id) {
+  setParameter(id, readFloatSerial());
+  setParameter(id + 1, readFloatSerial());
+  setParameter(id + 2, readFloatSerial());
 }
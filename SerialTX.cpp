@@ -0,0 +1,167 @@
+/*
+  SerialTX.cpp - Library for sending on the serial port without waiting for the UART
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "SerialTX.h"
+#include <avr/interrupt.h>
+
+//
+// The core's Serial.print() sits and waits for each byte to leave the UART, which at 115200 baud is ~87us a byte.
+// Instead, we copy into a ring buffer and let the data register empty interrupt feed the UART in the background.
+//
+// Telemetry is written as frames: if a frame doesn't fit in the buffer or in this loop's budget, the whole thing is
+// rolled back and counted as dropped, rather than sending half a line.
+//
+// Serial.begin() still sets up the UART (and receiving). Don't mix Serial.print() with this.
+//
+
+#define TX_BUFFER_SIZE 256 // Byte indexes wrap around on their own
+
+// head is where we write next, committed is how far the interrupt is allowed to send, tail is what it sends next
+static volatile byte txBuffer[TX_BUFFER_SIZE];
+static volatile byte txHead = 0;
+static volatile byte txCommitted = 0;
+static volatile byte txTail = 0;
+
+ISR(USART0_UDRE_vect){
+  if (txTail == txCommitted){
+    UCSR0B &= ~_BV(UDRIE0); // Nothing left, stop asking
+    return;
+  }
+  
+  UDR0 = txBuffer[txTail++];
+}
+
+SerialTX::SerialTX(){
+  _inFrame = false;
+  _overflow = false;
+  _frameStart = 0;
+  
+  _budget = SERIAL_TX_BUDGET;
+  _remaining = _budget;
+  
+  _dropped = 0;
+}
+
+// Call after Serial.begin()
+void SerialTX::init(){
+  txHead = txCommitted = txTail = 0;
+}
+
+void SerialTX::write(uint8_t data){
+  if (_overflow) return; // This frame is already lost
+  
+  if (_remaining == 0 || (byte)(txHead + 1) == txTail){
+    if (_inFrame){
+      _overflow = true;
+    }
+    else{
+      _dropped++;
+    }
+    return;
+  }
+  
+  txBuffer[txHead++] = data;
+  _remaining--;
+  
+  if (!_inFrame) commit();
+}
+
+// Hand everything written so far to the interrupt
+void SerialTX::commit(){
+  txCommitted = txHead;
+  UCSR0B |= _BV(UDRIE0);
+}
+
+///////////
+
+// Everything written until endFrame() goes out together, or not at all
+void SerialTX::beginFrame(){
+  _inFrame = true;
+  _overflow = false;
+  _frameStart = txHead;
+}
+
+// Returns false if the frame didn't fit and was dropped
+boolean SerialTX::endFrame(){
+  _inFrame = false;
+  
+  if (_overflow){
+    _remaining += (byte)(txHead - _frameStart); // Give back what we wrote before it overflowed
+    txHead = _frameStart;
+    _overflow = false;
+    _dropped++;
+    return false;
+  }
+  
+  commit();
+  return true;
+}
+
+// How much has been written since beginFrame()
+byte SerialTX::getFrameLength(){
+  return txHead - _frameStart;
+}
+
+// Throw away whatever was written to the frame after its first length bytes, to measure something without sending it
+// Returns false if that overflowed, and so didn't all get written
+boolean SerialTX::rollbackFrame(byte length){
+  boolean whole = !_overflow;
+  
+  _remaining += (byte)(txHead - _frameStart - length);
+  txHead = _frameStart + length;
+  _overflow = false;
+  
+  return whole;
+}
+
+///////////
+
+// Once per loop
+void SerialTX::resetBudget(){
+  _remaining = _budget;
+}
+
+void SerialTX::setBudget(int budget){
+  _budget = constrain(budget, SERIAL_TX_MIN_BUDGET, TX_BUFFER_SIZE);
+  _remaining = min(_remaining, _budget);
+}
+
+int SerialTX::getBudget(){
+  return _budget;
+}
+
+///////////
+
+// Bytes waiting to go out
+byte SerialTX::getQueued(){
+  return txHead - txTail;
+}
+
+// How much more we could write right now, for things that would rather wait than be dropped
+int SerialTX::getFree(){
+  if (_overflow) return 0;
+  return min(_remaining, TX_BUFFER_SIZE - 1 - getQueued());
+}
+
+// How many frames (or lone bytes) didn't fit?
+unsigned long SerialTX::getDropped(){
+  return _dropped;
+}
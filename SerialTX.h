@@ -0,0 +1,60 @@
+/*
+  SerialTX.h - Library for sending on the serial port without waiting for the UART
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef SerialTX_h
+#define SerialTX_h
+
+#include "WProgram.h"
+#include "Definitions.h"
+
+class SerialTX : public Print
+{
+  public:
+    SerialTX();
+    void init();
+    
+    virtual void write(uint8_t);
+    using Print::write;
+    
+    void beginFrame();
+    boolean endFrame();
+    byte getFrameLength();
+    boolean rollbackFrame(byte);
+    
+    void resetBudget();
+    void setBudget(int);
+    int getBudget();
+    
+    byte getQueued();
+    int getFree();
+    unsigned long getDropped();
+    
+  private:
+    void commit();
+    
+    boolean _inFrame;
+    boolean _overflow;
+    byte _frameStart;
+    
+    int _budget; // Bytes we may queue per loop
+    int _remaining; // Bytes left this loop
+    
+    unsigned long _dropped;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+  Telemetry.cpp - Library for framing binary telemetry records
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// A frame is:
+//   0xA5, 0x5A, type, payload length, payload, CRC (low byte first)
+//
+// The CRC is CRC-16/CCITT (0x1021, starting at 0xFFFF) over the type, length and payload. Two sync bytes and a
+// length make it cheap to find the next frame after a dropped byte, and the CRC throws away anything we got wrong.
+//
+
+#include "Telemetry.h"
+
+#define STATE_SYNC1 0
+#define STATE_SYNC2 1
+#define STATE_TYPE 2
+#define STATE_LENGTH 3
+#define STATE_PAYLOAD 4
+#define STATE_CRC1 5
+#define STATE_CRC2 6
+
+uint16_t telemetryCRC(uint16_t crc, uint8_t b){
+  crc ^= (uint16_t)b << 8;
+  for (uint8_t i=0; i<8; i++){
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+  
+  return crc;
+}
+
+// Wrap a record up into a frame, which needs room for length+TELEMETRY_OVERHEAD bytes
+// Returns how many bytes of frame to send
+uint8_t telemetryEncode(uint8_t type, const void *payload, uint8_t length, uint8_t *frame){
+  const uint8_t *data = (const uint8_t *)payload;
+  uint16_t crc = 0xFFFF;
+  uint8_t index = 0;
+  
+  frame[index++] = TELEMETRY_SYNC1;
+  frame[index++] = TELEMETRY_SYNC2;
+  
+  frame[index++] = type;
+  crc = telemetryCRC(crc, type);
+  frame[index++] = length;
+  crc = telemetryCRC(crc, length);
+  
+  for (uint8_t i=0; i<length; i++){
+    frame[index++] = data[i];
+    crc = telemetryCRC(crc, data[i]);
+  }
+  
+  frame[index++] = crc & 0xFF;
+  frame[index++] = crc >> 8;
+  
+  return index;
+}
+
+///////////
+
+TelemetryDecoder::TelemetryDecoder(){
+  _state = STATE_SYNC1;
+  _type = 0;
+  _length = 0;
+  _index = 0;
+  _errors = 0;
+}
+
+// Feed in one byte off the wire
+// Returns true if that completed a frame with a good CRC
+bool TelemetryDecoder::push(uint8_t b){
+  switch (_state){
+    case STATE_SYNC1:
+      if (b == TELEMETRY_SYNC1) _state = STATE_SYNC2;
+      break;
+    case STATE_SYNC2:
+      if (b == TELEMETRY_SYNC2) _state = STATE_TYPE;
+      else if (b != TELEMETRY_SYNC1) _state = STATE_SYNC1;
+      break;
+    case STATE_TYPE:
+      _type = b;
+      _crc = telemetryCRC(0xFFFF, b);
+      _state = STATE_LENGTH;
+      break;
+    case STATE_LENGTH:
+      if (b > TELEMETRY_MAX_PAYLOAD){
+        _errors++;
+        _state = STATE_SYNC1;
+        break;
+      }
+      
+      _length = b;
+      _index = 0;
+      _crc = telemetryCRC(_crc, b);
+      _state = b ? STATE_PAYLOAD : STATE_CRC1;
+      break;
+    case STATE_PAYLOAD:
+      _payload[_index++] = b;
+      _crc = telemetryCRC(_crc, b);
+      if (_index == _length) _state = STATE_CRC1;
+      break;
+    case STATE_CRC1:
+      _received = b;
+      _state = STATE_CRC2;
+      break;
+    case STATE_CRC2:
+      _received |= (uint16_t)b << 8;
+      _state = STATE_SYNC1;
+      
+      if (_received == _crc) return true;
+      _errors++;
+      break;
+  }
+  
+  return false;
+}
+
+uint8_t TelemetryDecoder::getType(){
+  return _type;
+}
+
+uint8_t TelemetryDecoder::getLength(){
+  return _length;
+}
+
+const uint8_t *TelemetryDecoder::getPayload(){
+  return _payload;
+}
+
+// How many frames have we thrown away?
+unsigned long TelemetryDecoder::getErrors(){
+  return _errors;
+}
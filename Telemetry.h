@@ -0,0 +1,94 @@
+/*
+  Telemetry.h - Library for framing binary telemetry records
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Telemetry_h
+#define Telemetry_h
+
+// No Arduino dependencies in here, so that the host tools can decode the same records the flight code sends
+#include <stdint.h>
+
+#define TELEMETRY_SYNC1 0xA5
+#define TELEMETRY_SYNC2 0x5A
+#define TELEMETRY_MAX_PAYLOAD 64
+#define TELEMETRY_OVERHEAD 6 // 2 sync bytes, type, length, 2 bytes of CRC
+
+// Record types
+#define TELEMETRY_FLIGHT 0x01
+#define TELEMETRY_BLACKBOX 0x02 // A piece of a blackbox dump: TelemetryBlackbox, then the data
+
+//
+// Records are sent exactly as they are laid out in memory. Both the AVR and any host we care about are little-endian,
+// and packing keeps the host compiler from padding them.
+//
+// Angles are in hundredths of a degree (rates in hundredths of a degree/second) so they fit in 16 bits.
+//
+struct TelemetryFlight {
+  uint32_t deltaTime; // Microseconds
+  int16_t roll;
+  int16_t pitch;
+  uint16_t heading; // 0-35999, past 327.67 degrees it wouldn't fit signed
+  int16_t accelAngle[3]; // X, Y, Z
+  int16_t gyro[3]; // Roll, pitch, yaw. Up to +/-327.67 degrees/second
+  int16_t mag[3]; // Raw X, Y, Z
+  int32_t altitude; // Centimeters
+  uint16_t battery; // Millivolts
+  uint16_t compensation; // Thousandths
+  uint16_t throttle;
+  uint16_t engines[6]; // Always room for a hex, unused engines are 0
+  uint8_t armed;
+  uint8_t mode;
+  uint16_t telemetryTime; // How long the last telemetry frame took to send, in microseconds
+} __attribute__((packed));
+
+#define TELEMETRY_BLACKBOX_CHUNK 56 // Most bytes of dump in one frame
+
+struct TelemetryBlackbox {
+  uint32_t offset; // Where this piece goes in the dump
+  uint32_t total; // How long the whole dump is. A piece at offset == total marks the end
+} __attribute__((packed));
+
+uint16_t telemetryCRC(uint16_t crc, uint8_t b);
+uint8_t telemetryEncode(uint8_t type, const void *payload, uint8_t length, uint8_t *frame);
+
+class TelemetryDecoder
+{
+  public:
+    TelemetryDecoder();
+    
+    bool push(uint8_t);
+    
+    uint8_t getType();
+    uint8_t getLength();
+    const uint8_t *getPayload();
+    
+    unsigned long getErrors();
+  
+  private:
+    uint8_t _state;
+    uint8_t _type;
+    uint8_t _length;
+    uint8_t _index;
+    uint16_t _crc;
+    uint16_t _received;
+    
+    uint8_t _payload[TELEMETRY_MAX_PAYLOAD];
+    
+    unsigned long _errors;
+};
+
+#endif
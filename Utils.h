@@ -25,6 +25,9 @@
 #define G_2_MPS2(g) (g * 9.80665)
 #define MPS2_2_G(m) (m * 0.10197162)
 
+// How many readings autoZero() takes the median of. Why 50? Because that's what the aeroquad project does
+#define ZERO_SAMPLES 50
+
 void isort(int *, byte);
 int findMedian(int *, byte);
 float filterSmooth(float, float, float);
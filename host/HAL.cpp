@@ -0,0 +1,714 @@
+/*
+  HAL.cpp - The Arduino core and ATmega2560 hardware, simulated for the host build
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include <stdio.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include "WProgram.h"
+#include "Wire.h"
+#include "EEPROM.h"
+#include "HAL.h"
+
+#define HAL_PINS 70
+#define HAL_ANALOG_CHANNELS 16
+#define HAL_PORTK_PIN 62 // A8 is bit 0 of port K
+#define HAL_SERIAL_PORTS 4
+#define HAL_SERIAL_BUFFER 128 // Received bytes the core holds on to before it starts dropping them
+#define HAL_ADC_PERIOD 1024 // Timer 0 overflows every 1024us, and that's what triggers the ADC
+#define HAL_ADC_MAX_BACKLOG 64 // After a long delay(), don't bother with every conversion we missed
+#define HAL_EEPROM_WRITE_TIME 3400 // Per byte, in microseconds
+#define HAL_PWM_FRAME 20000 // How often a PWM receiver sends each channel, in microseconds
+#define HAL_PPM_FRAME 22500
+
+// The flight code's interrupt handlers. Weak, since which ones exist depends on how it's configured
+extern "C" {
+  void ADC_vect(void) __attribute__((weak));
+  void USART0_UDRE_vect(void) __attribute__((weak));
+  void EE_READY_vect(void) __attribute__((weak));
+  void PCINT2_vect(void) __attribute__((weak));
+  void TIMER3_OVF_vect(void) __attribute__((weak));
+  void TIMER5_CAPT_vect(void) __attribute__((weak));
+}
+
+HalRegister8 SREG;
+HalRegister8 GTCCR;
+HalRegister8 TCCR1A, TCCR1B, TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+HalRegister8 TIMSK1, TIMSK3, TIMSK4, TIMSK5;
+HalRegister16 TCNT1, TCNT3, TCNT4, TCNT5;
+HalRegister16 ICR3, ICR4, ICR5;
+HalRegister16 OCR3A, OCR3B, OCR3C, OCR4A, OCR4B, OCR4C;
+HalRegister8 ADCSRA, ADCSRB, ADMUX;
+HalRegister16 ADC;
+HalRegister8 UCSR0A, UCSR0B, UCSR0C, UDR0;
+HalRegister8 UCSR1A, UCSR1B, UCSR1C, UDR1;
+HalRegister8 EECR, EEDR;
+HalRegister16 EEAR;
+HalRegister8 PCICR, PCMSK2, PINK;
+HalRegister8 SPCR, SPSR, SPDR;
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+HardwareSerial Serial3(3);
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+///////////
+// Time
+
+class VirtualClock : public HalClock
+{
+  public:
+    VirtualClock() : _now(0) {}
+    unsigned long micros(){ return _now; }
+    void wait(unsigned long us){ _now += us; }
+    
+  private:
+    unsigned long _now;
+};
+
+static VirtualClock virtualClock;
+static HalClock *halClock = &virtualClock;
+
+// While halInterrupts() is running a handler, time is when that interrupt would have happened
+static bool inInterrupt = false;
+static unsigned long interruptTime;
+static unsigned long lastInterrupts = 0;
+
+static unsigned long now(){
+  return inInterrupt ? interruptTime : halClock->micros();
+}
+
+void halSetClock(HalClock *clock){
+  halClock = clock ? clock : &virtualClock;
+  lastInterrupts = halClock->micros();
+}
+
+void halAdvance(unsigned long us){
+  virtualClock.wait(us);
+}
+
+unsigned long micros(){
+  return now();
+}
+
+unsigned long millis(){
+  return now() / 1000;
+}
+
+void delay(unsigned long ms){
+  halClock->wait(ms * 1000);
+  halInterrupts();
+}
+
+void delayMicroseconds(unsigned int us){
+  halClock->wait(us);
+}
+
+///////////
+// Timers
+
+// What a 16 bit timer's counter would read at time us, given its clock select bits, TOP, and where it was set to
+static uint16_t timerCount(unsigned long us, uint8_t clockSelect, uint16_t top, uint16_t offset = 0){
+  static const uint16_t prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  uint16_t prescaler = prescalers[clockSelect & 0x07];
+  if (!prescaler) return offset; // Stopped, or counting something external
+  
+  unsigned long long ticks = (unsigned long long)us * (F_CPU / 1000000) / prescaler + offset;
+  return ticks % ((unsigned long)top + 1);
+}
+
+static uint16_t timerTop(HalRegister8 &control, HalRegister16 &icr){
+  return (control.raw() & _BV(WGM33)) ? icr.raw() : 0xFFFF; // Mode 14 counts to ICRn, we don't use the others
+}
+
+// Writing TCNTn moves the count, which we keep as how far it is from where time alone would have it
+static uint16_t timerOffsets[6];
+
+static void timerSet(uint8_t timer, uint16_t value, uint8_t clockSelect, uint16_t top){
+  timerOffsets[timer] = 0;
+  timerOffsets[timer] = (value + (unsigned long)top + 1 - timerCount(now(), clockSelect, top)) % ((unsigned long)top + 1);
+}
+
+static uint16_t readTCNT1(uint16_t){ return timerCount(now(), TCCR1B.raw(), 0xFFFF, timerOffsets[1]); }
+static uint16_t readTCNT3(uint16_t){ return timerCount(now(), TCCR3B.raw(), timerTop(TCCR3B, ICR3), timerOffsets[3]); }
+static uint16_t readTCNT4(uint16_t){ return timerCount(now(), TCCR4B.raw(), timerTop(TCCR4B, ICR4), timerOffsets[4]); }
+static uint16_t readTCNT5(uint16_t){ return timerCount(now(), TCCR5B.raw(), 0xFFFF, timerOffsets[5]); }
+
+static void writeTCNT1(uint16_t, uint16_t value){ timerSet(1, value, TCCR1B.raw(), 0xFFFF); }
+static void writeTCNT3(uint16_t, uint16_t value){ timerSet(3, value, TCCR3B.raw(), timerTop(TCCR3B, ICR3)); }
+static void writeTCNT4(uint16_t, uint16_t value){ timerSet(4, value, TCCR4B.raw(), timerTop(TCCR4B, ICR4)); }
+static void writeTCNT5(uint16_t, uint16_t value){ timerSet(5, value, TCCR5B.raw(), 0xFFFF); }
+
+// Timer 3 overflows once per ESC frame. The handler only latches the new pulses, so once per call is plenty
+static void runTimer3(unsigned long, unsigned long to){
+  if (!TIMER3_OVF_vect || !(TIMSK3.raw() & _BV(TOIE3)) || !(TCCR3B.raw() & 0x07)) return;
+  
+  interruptTime = to;
+  TIMER3_OVF_vect();
+}
+
+///////////
+// Pins and the ADC
+
+static uint8_t pins[HAL_PINS];
+static int analogWrites[HAL_PINS];
+static uint16_t analog[HAL_ANALOG_CHANNELS];
+
+void pinMode(uint8_t, uint8_t){
+}
+
+void digitalWrite(uint8_t pin, uint8_t value){
+  if (pin < HAL_PINS) pins[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin){
+  return pin < HAL_PINS ? pins[pin] : LOW;
+}
+
+void analogReference(uint8_t){
+}
+
+int analogRead(uint8_t pin){
+  if (pin >= A0) pin -= A0;
+  return pin < HAL_ANALOG_CHANNELS ? analog[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int value){
+  if (pin < HAL_PINS) analogWrites[pin] = value;
+}
+
+void halSetAnalog(uint8_t channel, uint16_t value){
+  if (channel < HAL_ANALOG_CHANNELS) analog[channel] = value;
+}
+
+void halSetPin(uint8_t pin, uint8_t value){
+  digitalWrite(pin, value);
+}
+
+uint8_t halGetPin(uint8_t pin){
+  return digitalRead(pin);
+}
+
+int halGetAnalogWrite(uint8_t pin){
+  return pin < HAL_PINS ? analogWrites[pin] : 0;
+}
+
+static uint8_t readPINK(uint8_t){
+  uint8_t value = 0;
+  for (uint8_t bit = 0; bit < 8; bit++){
+    if (pins[HAL_PORTK_PIN + bit]) value |= 1 << bit;
+  }
+  
+  return value;
+}
+
+// Free running, triggered by timer 0
+static void runADC(unsigned long from, unsigned long to){
+  if (!ADC_vect || (ADCSRA.raw() & (_BV(ADEN) | _BV(ADIE))) != (_BV(ADEN) | _BV(ADIE))) return;
+  
+  unsigned long first = from / HAL_ADC_PERIOD + 1;
+  unsigned long last = to / HAL_ADC_PERIOD;
+  if (last - first >= HAL_ADC_MAX_BACKLOG) first = last - HAL_ADC_MAX_BACKLOG + 1;
+  
+  for (unsigned long conversion = first; conversion <= last && first <= last; conversion++){
+    uint8_t channel = (ADMUX.raw() & 0x07) | ((ADCSRB.raw() & _BV(MUX5)) ? 0x08 : 0);
+    ADC.setRaw(analog[channel]);
+    interruptTime = conversion * HAL_ADC_PERIOD;
+    ADC_vect();
+  }
+}
+
+///////////
+// Receivers
+
+struct HalEdge {
+  unsigned long time;
+  uint8_t pin;
+  uint8_t level;
+  
+  bool operator<(const HalEdge &other) const { return time < other.time; }
+};
+
+static unsigned int pulseWidths[8]; // Per bit of port K
+static unsigned int ppmWidths[16];
+static uint8_t ppmCount = 0;
+
+void halSetPulse(uint8_t pin, unsigned int width){
+  if (pin >= HAL_PORTK_PIN && pin < HAL_PORTK_PIN + 8) pulseWidths[pin - HAL_PORTK_PIN] = width;
+}
+
+void halSetPPM(const unsigned int *widths, uint8_t count){
+  ppmCount = min(count, (uint8_t)16);
+  for (uint8_t i = 0; i < ppmCount; i++){
+    ppmWidths[i] = widths[i];
+  }
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t, unsigned long){
+  if (pin < HAL_PORTK_PIN || pin >= HAL_PORTK_PIN + 8) return 0;
+  return pulseWidths[pin - HAL_PORTK_PIN];
+}
+
+// One channel after another, like most receivers, every HAL_PWM_FRAME
+static void runPWM(unsigned long from, unsigned long to){
+  std::vector<HalEdge> edges;
+  
+  for (unsigned long frame = from / HAL_PWM_FRAME; frame <= to / HAL_PWM_FRAME; frame++){
+    unsigned long time = frame * HAL_PWM_FRAME;
+    
+    for (uint8_t bit = 0; bit < 8; bit++){
+      if (!pulseWidths[bit]) continue;
+      
+      HalEdge rise = {time, (uint8_t)(HAL_PORTK_PIN + bit), HIGH};
+      HalEdge fall = {time + pulseWidths[bit], (uint8_t)(HAL_PORTK_PIN + bit), LOW};
+      if (rise.time > from && rise.time <= to) edges.push_back(rise);
+      if (fall.time > from && fall.time <= to) edges.push_back(fall);
+      time += pulseWidths[bit];
+    }
+  }
+  
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size(); i++){
+    pins[edges[i].pin] = edges[i].level;
+    
+    uint8_t mask = 1 << (edges[i].pin - HAL_PORTK_PIN);
+    if (PCINT2_vect && (PCICR.raw() & _BV(PCIE2)) && (PCMSK2.raw() & mask)){
+      interruptTime = edges[i].time;
+      PCINT2_vect();
+    }
+  }
+}
+
+// A rising edge at the start of every channel and one at the end of the last, then the sync gap
+static void runPPM(unsigned long from, unsigned long to){
+  if (!ppmCount || !TIMER5_CAPT_vect || !(TIMSK5.raw() & _BV(ICIE5))) return;
+  
+  for (unsigned long frame = from / HAL_PPM_FRAME; frame <= to / HAL_PPM_FRAME; frame++){
+    unsigned long time = frame * HAL_PPM_FRAME;
+    
+    for (uint8_t edge = 0; edge <= ppmCount; edge++){
+      if (time > from && time <= to){
+        ICR5.setRaw(timerCount(time, TCCR5B.raw(), 0xFFFF, timerOffsets[5]));
+        interruptTime = time;
+        TIMER5_CAPT_vect();
+      }
+      if (edge < ppmCount) time += ppmWidths[edge];
+    }
+  }
+}
+
+///////////
+// Serial
+
+struct HalSerialPort {
+  long baud;
+  std::deque<uint8_t> wire; // Sent to us, but not here yet
+  std::deque<uint8_t> received; // Here, waiting for read()
+  double receiveCredit; // Bytes' worth of time we've waited for the next one to arrive
+  double sendCredit;
+  std::string sent;
+  FILE *echo;
+};
+
+static HalSerialPort ports[HAL_SERIAL_PORTS];
+
+static void serialSend(uint8_t port, uint8_t b){
+  if (ports[port].echo){
+    fputc(b, ports[port].echo);
+    fflush(ports[port].echo);
+  }
+  else{
+    ports[port].sent.push_back(b);
+  }
+}
+
+void halSerialInput(uint8_t port, const uint8_t *data, size_t length){
+  if (port < HAL_SERIAL_PORTS) ports[port].wire.insert(ports[port].wire.end(), data, data + length);
+}
+
+size_t halSerialOutput(uint8_t port, uint8_t *data, size_t length){
+  if (port >= HAL_SERIAL_PORTS) return 0;
+  
+  std::string &sent = ports[port].sent;
+  length = min(length, sent.size());
+  memcpy(data, sent.data(), length);
+  sent.erase(0, length);
+  
+  return length;
+}
+
+size_t halSerialPending(uint8_t port){
+  if (port >= HAL_SERIAL_PORTS) return 0;
+  return ports[port].wire.size() + ports[port].received.size();
+}
+
+void halSerialEcho(uint8_t port, FILE *file){
+  if (port < HAL_SERIAL_PORTS) ports[port].echo = file;
+}
+
+// 10 bits a byte, at whatever baud rate begin() set
+static void runSerial(unsigned long from, unsigned long to){
+  for (uint8_t i = 0; i < HAL_SERIAL_PORTS; i++){
+    HalSerialPort &port = ports[i];
+    if (!port.baud) continue;
+    
+    double bytes = (double)(to - from) * port.baud / 10 / 1000000;
+    
+    port.receiveCredit = port.wire.empty() ? 0 : port.receiveCredit + bytes;
+    while (port.receiveCredit >= 1 && !port.wire.empty()){
+      if (port.received.size() < HAL_SERIAL_BUFFER) port.received.push_back(port.wire.front());
+      port.wire.pop_front();
+      port.receiveCredit -= 1;
+    }
+    
+    // Only port 0 has anything sending from the data register empty interrupt
+    if (i != 0 || !USART0_UDRE_vect) continue;
+    
+    port.sendCredit = (UCSR0B.raw() & _BV(UDRIE0)) ? port.sendCredit + bytes : 0;
+    interruptTime = to;
+    while (port.sendCredit >= 1 && (UCSR0B.raw() & _BV(UDRIE0))){
+      USART0_UDRE_vect();
+      if (UCSR0B.raw() & _BV(UDRIE0)) serialSend(0, UDR0.raw());
+      port.sendCredit -= 1;
+    }
+  }
+}
+
+HardwareSerial::HardwareSerial(uint8_t port){
+  _port = port;
+}
+
+void HardwareSerial::begin(long baud){
+  ports[_port].baud = baud;
+}
+
+void HardwareSerial::end(){
+  ports[_port].baud = 0;
+}
+
+int HardwareSerial::available(){
+  return ports[_port].received.size();
+}
+
+int HardwareSerial::peek(){
+  return ports[_port].received.empty() ? -1 : ports[_port].received.front();
+}
+
+int HardwareSerial::read(){
+  if (ports[_port].received.empty()) return -1;
+  
+  uint8_t b = ports[_port].received.front();
+  ports[_port].received.pop_front();
+  return b;
+}
+
+// Like the 0022 core, this throws away what's been received
+void HardwareSerial::flush(){
+  ports[_port].received.clear();
+}
+
+// The core waits for each byte to go; here it's gone straight away
+void HardwareSerial::write(uint8_t b){
+  serialSend(_port, b);
+}
+
+///////////
+// EEPROM
+
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+static unsigned long eepromDone; // When the write in progress finishes
+
+uint8_t *halEEPROM(){
+  return eeprom;
+}
+
+uint8_t EEPROMClass::read(int address){
+  return eeprom[address % HAL_EEPROM_SIZE];
+}
+
+void EEPROMClass::write(int address, uint8_t value){
+  eeprom[address % HAL_EEPROM_SIZE] = value;
+}
+
+// Setting EERE reads a byte into EEDR, setting EEPE writes EEDR out (and stays set until that's done)
+static void writeEECR(uint8_t previous, uint8_t value){
+  if (value & _BV(EERE)){
+    EEDR.setRaw(eeprom[EEAR.raw() % HAL_EEPROM_SIZE]);
+    EECR.setRaw(EECR.raw() & ~_BV(EERE));
+  }
+  
+  if ((value & _BV(EEPE)) && !(previous & _BV(EEPE))){
+    eeprom[EEAR.raw() % HAL_EEPROM_SIZE] = EEDR.raw();
+    eepromDone = now() + HAL_EEPROM_WRITE_TIME;
+  }
+}
+
+// The ready interrupt fires whenever it's enabled and there's no write going
+static void runEEPROM(unsigned long, unsigned long to){
+  interruptTime = to;
+  
+  while (true){
+    if (EECR.raw() & _BV(EEPE)){
+      if ((long)(eepromDone - to) > 0) return;
+      
+      EECR.setRaw(EECR.raw() & ~(_BV(EEPE) | _BV(EEMPE)));
+      interruptTime = eepromDone;
+    }
+    
+    if (!EE_READY_vect || !(EECR.raw() & _BV(EERIE))) return;
+    EE_READY_vect();
+  }
+}
+
+///////////
+// SPI, with nothing on the bus
+
+static void writeSPDR(uint8_t, uint8_t){
+  SPDR.setRaw(0xFF);
+  SPSR.setRaw(SPSR.raw() | _BV(SPIF));
+}
+
+///////////
+// I2C
+
+static HalI2CDevice *devices[128];
+
+void halAttachI2C(uint8_t address, HalI2CDevice *device){
+  devices[address & 0x7F] = device;
+}
+
+TwoWire::TwoWire(){
+  _address = 0;
+  _txLength = 0;
+  _rxIndex = 0;
+  _rxLength = 0;
+}
+
+void TwoWire::begin(){
+}
+
+void TwoWire::beginTransmission(uint8_t address){
+  _address = address & 0x7F;
+  _txLength = 0;
+}
+
+void TwoWire::beginTransmission(int address){
+  beginTransmission((uint8_t)address);
+}
+
+// 0 for success, 2 if nobody answered, same as the real thing
+uint8_t TwoWire::endTransmission(){
+  HalI2CDevice *device = devices[_address];
+  if (!device) return 2;
+  
+  device->write(_txBuffer, _txLength);
+  _txLength = 0;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity){
+  HalI2CDevice *device = devices[address & 0x7F];
+  
+  _rxIndex = 0;
+  _rxLength = device ? device->read(_rxBuffer, min(quantity, (uint8_t)BUFFER_LENGTH)) : 0;
+  return _rxLength;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity){
+  return requestFrom((uint8_t)address, (uint8_t)quantity);
+}
+
+void TwoWire::send(uint8_t data){
+  if (_txLength < BUFFER_LENGTH) _txBuffer[_txLength++] = data;
+}
+
+void TwoWire::send(uint8_t *data, uint8_t quantity){
+  for (uint8_t i = 0; i < quantity; i++){
+    send(data[i]);
+  }
+}
+
+void TwoWire::send(int data){
+  send((uint8_t)data);
+}
+
+void TwoWire::send(char *data){
+  send((uint8_t *)data, strlen(data));
+}
+
+uint8_t TwoWire::available(){
+  return _rxLength - _rxIndex;
+}
+
+uint8_t TwoWire::receive(){
+  return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : 0;
+}
+
+///////////
+// Print, the same as the 0022 core's
+
+void Print::write(const char *str){
+  while (*str) write(*str++);
+}
+
+void Print::write(const uint8_t *buffer, size_t size){
+  while (size--) write(*buffer++);
+}
+
+void Print::print(const char str[]){
+  write(str);
+}
+
+void Print::print(char c, int base){
+  print((long)c, base);
+}
+
+void Print::print(unsigned char b, int base){
+  print((unsigned long)b, base);
+}
+
+void Print::print(int n, int base){
+  print((long)n, base);
+}
+
+void Print::print(unsigned int n, int base){
+  print((unsigned long)n, base);
+}
+
+void Print::print(long n, int base){
+  if (base == 0){
+    write(n);
+  }
+  else if (base == 10){
+    if (n < 0){
+      print('-');
+      n = -n;
+    }
+    printNumber(n, 10);
+  }
+  else{
+    printNumber(n, base);
+  }
+}
+
+void Print::print(unsigned long n, int base){
+  if (base == 0) write(n);
+  else printNumber(n, base);
+}
+
+void Print::print(double n, int digits){
+  printFloat(n, digits);
+}
+
+void Print::println(){
+  print('\r');
+  print('\n');
+}
+
+void Print::println(const char c[]){ print(c); println(); }
+void Print::println(char c, int base){ print(c, base); println(); }
+void Print::println(unsigned char b, int base){ print(b, base); println(); }
+void Print::println(int n, int base){ print(n, base); println(); }
+void Print::println(unsigned int n, int base){ print(n, base); println(); }
+void Print::println(long n, int base){ print(n, base); println(); }
+void Print::println(unsigned long n, int base){ print(n, base); println(); }
+void Print::println(double n, int digits){ print(n, digits); println(); }
+
+void Print::printNumber(unsigned long n, uint8_t base){
+  unsigned char buf[8 * sizeof(long)];
+  unsigned long i = 0;
+  
+  if (n == 0){
+    print('0');
+    return;
+  }
+  
+  while (n > 0){
+    buf[i++] = n % base;
+    n /= base;
+  }
+  
+  for (; i > 0; i--){
+    print((char)(buf[i - 1] < 10 ? '0' + buf[i - 1] : 'A' + buf[i - 1] - 10));
+  }
+}
+
+void Print::printFloat(double number, uint8_t digits){
+  if (number < 0.0){
+    print('-');
+    number = -number;
+  }
+  
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i){
+    rounding /= 10.0;
+  }
+  number += rounding;
+  
+  unsigned long intPart = (unsigned long)number;
+  double remainder = number - (double)intPart;
+  print(intPart);
+  
+  if (digits > 0) print(".");
+  
+  while (digits-- > 0){
+    remainder *= 10.0;
+    int toPrint = int(remainder);
+    print(toPrint);
+    remainder -= toPrint;
+  }
+}
+
+///////////
+
+void halInterrupts(){
+  unsigned long to = halClock->micros();
+  unsigned long from = lastInterrupts;
+  if (to == from) return;
+  lastInterrupts = to;
+  
+  inInterrupt = true;
+  runPWM(from, to);
+  runPPM(from, to);
+  runADC(from, to);
+  runTimer3(from, to);
+  runSerial(from, to);
+  runEEPROM(from, to);
+  inInterrupt = false;
+}
+
+// Power on
+static struct HalSetup {
+  HalSetup(){
+    memset(eeprom, 0xFF, sizeof(eeprom)); // Erased
+    SREG.setRaw(_BV(SREG_I)); // The core turns interrupts on before setup()
+    
+    TCNT1.hook(readTCNT1, writeTCNT1);
+    TCNT3.hook(readTCNT3, writeTCNT3);
+    TCNT4.hook(readTCNT4, writeTCNT4);
+    TCNT5.hook(readTCNT5, writeTCNT5);
+    PINK.hook(readPINK, 0);
+    EECR.hook(0, writeEECR);
+    SPDR.hook(0, writeSPDR);
+  }
+} halSetup;
@@ -0,0 +1,82 @@
+/*
+  HAL.h - Controls for the simulated hardware the host build runs on
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef HAL_h
+#define HAL_h
+
+//
+// The flight code doesn't know about any of this: it calls the Arduino core as usual, and on the host that's
+// HAL.cpp. This is the other side, for whatever is running it (host/main.cpp, a simulator): the clock, what the
+// sensors, receiver and battery say, and what comes out of the serial ports.
+//
+// Interrupts happen in halInterrupts(), which works through everything the hardware would have done since the
+// last call (ADC conversions, receiver edges, bytes leaving the UART, EEPROM writes...) in simulated time. Call
+// it after every loop(). delay() calls it too.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Where time comes from. The built-in clock only moves when told to (halAdvance(), or delay())
+class HalClock
+{
+  public:
+    virtual unsigned long micros() = 0;
+    virtual void wait(unsigned long us) = 0; // delay() and friends
+    virtual ~HalClock(){}
+};
+
+void halSetClock(HalClock *clock); // 0 for the built-in one
+void halAdvance(unsigned long us);
+
+void halInterrupts();
+
+// An I2C device, answering for one address
+class HalI2CDevice
+{
+  public:
+    virtual void write(const uint8_t *data, uint8_t length) = 0; // One transmission, register address first
+    virtual uint8_t read(uint8_t *data, uint8_t length) = 0; // Returns how many bytes it had
+    virtual ~HalI2CDevice(){}
+};
+
+void halAttachI2C(uint8_t address, HalI2CDevice *device); // 0 to unplug it
+
+// Pins
+void halSetAnalog(uint8_t channel, uint16_t value); // ADC counts, 0-1023
+void halSetPin(uint8_t pin, uint8_t value); // For digitalRead() of inputs
+uint8_t halGetPin(uint8_t pin); // Outputs, e.g. the LEDs
+int halGetAnalogWrite(uint8_t pin);
+
+// Receiver. Widths in microseconds, 0 to stop sending
+void halSetPulse(uint8_t pin, unsigned int width); // A PWM receiver, one pin per channel
+void halSetPPM(const unsigned int *widths, uint8_t count); // PPM-sum into the timer 5 input capture pin
+
+// Serial ports 0-3
+void halSerialInput(uint8_t port, const uint8_t *data, size_t length); // As if it came down the wire
+size_t halSerialOutput(uint8_t port, uint8_t *data, size_t length); // Take what's been sent
+size_t halSerialPending(uint8_t port); // Bytes of input the sketch hasn't read() yet
+void halSerialEcho(uint8_t port, FILE *file); // Write what's sent straight to file instead, 0 to stop
+
+// The EEPROM's contents, all 4K of it
+uint8_t *halEEPROM();
+
+#define HAL_EEPROM_SIZE 4096
+
+#endif
@@ -0,0 +1,213 @@
+/*
+  QuadModel.cpp - Rigid body physics of a quad, for flying the flight code in simulation
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include <math.h>
+
+#include "QuadModel.h"
+
+// Where each motor is, as a multiple of arm / sqrt(2), and which way its torque turns the frame. The left front
+// and right rear props spin counterclockwise, so the frame turns clockwise (positive yaw) when they speed up. That's
+// what the mixer expects.
+static const double motorLayout[MODEL_MOTORS][3] = {
+  // Front, right, yaw
+  {  1.0, -1.0,  1.0 }, // Left front
+  {  1.0,  1.0, -1.0 }, // Right front
+  { -1.0, -1.0, -1.0 }, // Left rear
+  { -1.0,  1.0,  1.0 }  // Right rear
+};
+
+Quaternion Quaternion::fromEuler(double roll, double pitch, double yaw){
+  double cr = cos(roll / 2), sr = sin(roll / 2);
+  double cp = cos(pitch / 2), sp = sin(pitch / 2);
+  double cy = cos(yaw / 2), sy = sin(yaw / 2);
+  
+  return Quaternion(
+    cr * cp * cy + sr * sp * sy,
+    sr * cp * cy - cr * sp * sy,
+    cr * sp * cy + sr * cp * sy,
+    cr * cp * sy - sr * sp * cy
+  );
+}
+
+Vector3 Quaternion::rotate(const Vector3 &v) const {
+  Vector3 u(x, y, z);
+  Vector3 t = u.cross(v) * 2;
+  return v + t * w + u.cross(t);
+}
+
+Vector3 Quaternion::unrotate(const Vector3 &v) const {
+  return Quaternion(w, -x, -y, -z).rotate(v);
+}
+
+double Quaternion::getRoll() const {
+  return atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+}
+
+double Quaternion::getPitch() const {
+  double s = 2 * (w * y - z * x);
+  return asin(s > 1 ? 1 : (s < -1 ? -1 : s));
+}
+
+double Quaternion::getYaw() const {
+  return atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+}
+
+///////////
+
+// Roughly a 450 size quad on a 3S battery
+QuadParameters::QuadParameters(){
+  mass = 1.1;
+  arm = 0.225;
+  inertia = Vector3(0.011, 0.011, 0.021);
+  maxThrust = 7.5;
+  torqueRatio = 0.016;
+  motorTimeConstant = 0.04;
+  drag = 0.3;
+  rotationalDrag = 0.005;
+}
+
+QuadModel::QuadModel(const QuadParameters &parameters){
+  _parameters = parameters;
+  reset(0);
+}
+
+void QuadModel::reset(double heading){
+  _time = 0;
+  _position = Vector3();
+  _velocity = Vector3();
+  _acceleration = Vector3();
+  _attitude = Quaternion::fromEuler(0, 0, heading);
+  _rates = Vector3();
+  _push = Vector3();
+  _pushUntil = 0;
+  
+  for (uint8_t motor = 0; motor < MODEL_MOTORS; motor++){
+    _motors[motor] = 0;
+  }
+}
+
+// Semi-implicit Euler. Keep dT small (a few hundred microseconds), the motors are quick
+void QuadModel::step(const uint16_t *pulses, double dT){
+  double a = _parameters.arm / sqrt(2.0);
+  double thrust = 0;
+  Vector3 torque;
+  
+  for (uint8_t motor = 0; motor < MODEL_MOTORS; motor++){
+    // ESC: 1000us is stopped, 2000us is flat out. No pulses at all is stopped too
+    double command = (pulses[motor] - 1000.0) / 1000.0;
+    if (command < 0) command = 0;
+    if (command > 1) command = 1;
+    
+    _motors[motor] += (command - _motors[motor]) * fmin(dT / _parameters.motorTimeConstant, 1.0);
+    
+    // Thrust goes with the square of prop speed
+    double force = _parameters.maxThrust * _motors[motor] * _motors[motor];
+    thrust += force;
+    
+    Vector3 position(motorLayout[motor][0] * a, motorLayout[motor][1] * a, 0);
+    torque = torque + position.cross(Vector3(0, 0, -force));
+    torque.z += motorLayout[motor][2] * _parameters.torqueRatio * force;
+  }
+  
+  torque = torque - _rates * _parameters.rotationalDrag;
+  if (_time < _pushUntil) torque = torque + _push;
+  
+  // Euler's equations, with a diagonal inertia
+  const Vector3 &inertia = _parameters.inertia;
+  Vector3 momentum(inertia.x * _rates.x, inertia.y * _rates.y, inertia.z * _rates.z);
+  Vector3 net = torque - _rates.cross(momentum);
+  _rates = _rates + Vector3(net.x / inertia.x, net.y / inertia.y, net.z / inertia.z) * dT;
+  
+  // q' = q * (0, rates) / 2
+  Quaternion &q = _attitude;
+  Vector3 &r = _rates;
+  Quaternion dq(
+    -q.x * r.x - q.y * r.y - q.z * r.z,
+    q.w * r.x + q.y * r.z - q.z * r.y,
+    q.w * r.y - q.x * r.z + q.z * r.x,
+    q.w * r.z + q.x * r.y - q.y * r.x
+  );
+  q.w += dq.w * dT / 2;
+  q.x += dq.x * dT / 2;
+  q.y += dq.y * dT / 2;
+  q.z += dq.z * dT / 2;
+  
+  double length = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+  q.w /= length;
+  q.x /= length;
+  q.y /= length;
+  q.z /= length;
+  
+  Vector3 force = _attitude.rotate(Vector3(0, 0, -thrust)) - _velocity * _parameters.drag;
+  _acceleration = force * (1 / _parameters.mass) + Vector3(0, 0, MODEL_GRAVITY);
+  _velocity = _velocity + _acceleration * dT;
+  _position = _position + _velocity * dT;
+  
+  // Sitting on the ground: it holds us up and level, and stops us turning
+  if (_position.z >= 0 && _velocity.z >= 0){
+    _position.z = 0;
+    _velocity = Vector3();
+    _acceleration = Vector3();
+    _rates = Vector3();
+    _attitude = Quaternion::fromEuler(0, 0, _attitude.getYaw());
+  }
+  
+  _time += dT;
+}
+
+void QuadModel::push(const Vector3 &torque, double duration){
+  _push = torque;
+  _pushUntil = _time + duration;
+}
+
+double QuadModel::getTime(){
+  return _time;
+}
+
+const Vector3 &QuadModel::getPosition(){
+  return _position;
+}
+
+const Vector3 &QuadModel::getVelocity(){
+  return _velocity;
+}
+
+const Quaternion &QuadModel::getAttitude(){
+  return _attitude;
+}
+
+const Vector3 &QuadModel::getRates(){
+  return _rates;
+}
+
+Vector3 QuadModel::getSpecificForce(){
+  return _attitude.unrotate(_acceleration - Vector3(0, 0, MODEL_GRAVITY));
+}
+
+double QuadModel::getMotor(uint8_t motor){
+  return _motors[motor];
+}
+
+double QuadModel::getHoverPulse(){
+  return 1000 + 1000 * sqrt(_parameters.mass * MODEL_GRAVITY / (MODEL_MOTORS * _parameters.maxThrust));
+}
+
+bool QuadModel::isGrounded(){
+  return _position.z >= 0 && _velocity.z == 0;
+}
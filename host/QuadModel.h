@@ -0,0 +1,112 @@
+/*
+  QuadModel.h - Rigid body physics of a quad, for flying the flight code in simulation
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef QuadModel_h
+#define QuadModel_h
+
+//
+// Everything is in SI units, in a north-east-down earth frame and a front-right-down body frame: positive roll is
+// the right side down, positive pitch is the nose up, positive yaw is clockwise seen from above.
+//
+// That isn't what the flight code calls positive (its roll is positive left side down, and its pitch is positive
+// nose down), but it's what the sensors' datasheets and any physics book use. SimSensors turns one into the other,
+// through the way the boards are mounted.
+//
+
+#include <stdint.h>
+
+#define MODEL_MOTORS 4 // X frame: left front, right front, left rear, right rear, like Definitions.h
+#define MODEL_GRAVITY 9.80665
+
+struct Vector3 {
+  double x, y, z;
+  
+  Vector3() : x(0), y(0), z(0) {}
+  Vector3(double x, double y, double z) : x(x), y(y), z(z) {}
+  
+  Vector3 operator+(const Vector3 &v) const { return Vector3(x + v.x, y + v.y, z + v.z); }
+  Vector3 operator-(const Vector3 &v) const { return Vector3(x - v.x, y - v.y, z - v.z); }
+  Vector3 operator*(double s) const { return Vector3(x * s, y * s, z * s); }
+  Vector3 cross(const Vector3 &v) const { return Vector3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+};
+
+// Rotates body into earth
+struct Quaternion {
+  double w, x, y, z;
+  
+  Quaternion() : w(1), x(0), y(0), z(0) {}
+  Quaternion(double w, double x, double y, double z) : w(w), x(x), y(y), z(z) {}
+  
+  static Quaternion fromEuler(double roll, double pitch, double yaw);
+  
+  Vector3 rotate(const Vector3 &v) const; // Body to earth
+  Vector3 unrotate(const Vector3 &v) const; // Earth to body
+  
+  double getRoll() const;
+  double getPitch() const;
+  double getYaw() const;
+};
+
+struct QuadParameters {
+  double mass; // kg
+  double arm; // Center to each motor, m
+  Vector3 inertia; // Diagonal, kg m^2
+  double maxThrust; // Per motor at full throttle, N
+  double torqueRatio; // Yaw torque per newton of thrust, m
+  double motorTimeConstant; // Spin up/down, s
+  double drag; // Linear, N per m/s
+  double rotationalDrag; // N m per rad/s
+  
+  QuadParameters();
+};
+
+class QuadModel
+{
+  public:
+    QuadModel(const QuadParameters &parameters);
+    
+    void reset(double heading); // On the ground, level, motors stopped
+    void step(const uint16_t *pulses, double dT); // ESC pulse widths in microseconds, time in seconds
+    void push(const Vector3 &torque, double duration); // A gust, in body N m
+    
+    double getTime();
+    const Vector3 &getPosition();
+    const Vector3 &getVelocity();
+    const Quaternion &getAttitude();
+    const Vector3 &getRates(); // Body, rad/s
+    Vector3 getSpecificForce(); // What an accelerometer feels, body m/s^2
+    double getMotor(uint8_t motor); // Speed, 0-1
+    double getHoverPulse(); // The pulse width that holds it up, level, with the motors all together
+    bool isGrounded();
+    
+  private:
+    QuadParameters _parameters;
+    
+    double _time;
+    Vector3 _position;
+    Vector3 _velocity;
+    Vector3 _acceleration;
+    Quaternion _attitude;
+    Vector3 _rates;
+    double _motors[MODEL_MOTORS];
+    
+    Vector3 _push;
+    double _pushUntil;
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+  SimSensors.cpp - Simulated ITG-3200, ADXL345, HMC5883L and BMP085, on the host's I2C bus
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "SimSensors.h"
+#include "Definitions.h"
+
+#define SIM_DEGREES (180.0 / M_PI)
+#define SIM_SEA_LEVEL 101325.0 // Pa
+#define SIM_TEMPERATURE 250 // Tenths of a degree C, for the gyro and the baro
+
+// Earth's field where I live, roughly, in gauss: north and down
+static const Vector3 magneticField(0.19, 0.0, 0.47);
+
+// How the boards are mounted
+static Vector3 toChip(const Vector3 &body){
+  return Vector3(body.x, -body.y, -body.z);
+}
+
+// One pole low pass, for the chips' own filters
+static double lowPass(double previous, double value, double cutoff, double dT){
+  return previous + (value - previous) * (1 - exp(-2 * M_PI * cutoff * dT));
+}
+
+static Vector3 lowPass(const Vector3 &previous, const Vector3 &value, double cutoff, double dT){
+  return Vector3(lowPass(previous.x, value.x, cutoff, dT), lowPass(previous.y, value.y, cutoff, dT), lowPass(previous.z, value.z, cutoff, dT));
+}
+
+SensorNoise::SensorNoise(){
+  gyroNoise = 2.0;
+  gyroBias = 30.0;
+  accelNoise = 1.5;
+  accelBias = 6.0;
+  vibration = 25.0;
+  magNoise = 2.0;
+  baroNoise = 4.0;
+}
+
+SensorNoise SensorNoise::none(){
+  SensorNoise noise;
+  noise.gyroNoise = noise.gyroBias = 0;
+  noise.accelNoise = noise.accelBias = noise.vibration = 0;
+  noise.magNoise = noise.baroNoise = 0;
+  return noise;
+}
+
+///////////
+
+SimChip::SimChip(QuadModel &model, std::mt19937 &random) : _model(model), _random(random){
+  memset(_registers, 0, sizeof(_registers));
+  _pointer = 0;
+}
+
+// The first byte sets the register pointer, anything after that is written from there on
+void SimChip::write(const uint8_t *data, uint8_t length){
+  if (!length) return;
+  
+  _pointer = data[0];
+  for (uint8_t i = 1; i < length; i++){
+    _registers[_pointer] = data[i];
+    written(_pointer++);
+  }
+}
+
+uint8_t SimChip::read(uint8_t *data, uint8_t length){
+  reading();
+  
+  for (uint8_t i = 0; i < length; i++){
+    data[i] = _registers[_pointer++];
+  }
+  
+  return length;
+}
+
+double SimChip::noise(double deviation){
+  if (deviation <= 0) return 0;
+  
+  std::normal_distribution<double> distribution(0, deviation);
+  return distribution(_random);
+}
+
+static int16_t saturate(double value){
+  if (value > 32767) return 32767;
+  if (value < -32768) return -32768;
+  return lround(value);
+}
+
+void SimChip::putBigEndian(uint8_t address, double value){
+  uint16_t word = saturate(value);
+  _registers[address] = word >> 8;
+  _registers[(uint8_t)(address + 1)] = word & 0xFF;
+}
+
+void SimChip::putLittleEndian(uint8_t address, double value){
+  uint16_t word = saturate(value);
+  _registers[address] = word & 0xFF;
+  _registers[(uint8_t)(address + 1)] = word >> 8;
+}
+
+///////////
+// ITG-3200: 14.375 LSB per degree/s, registers 0x1B-0x22 are temperature then X, Y, Z, high byte first
+
+SimITG3200::SimITG3200(QuadModel &model, std::mt19937 &random, const SensorNoise &noise) : SimChip(model, random){
+  std::uniform_real_distribution<double> bias(-noise.gyroBias, noise.gyroBias);
+  _bias = Vector3(bias(random), bias(random), bias(random));
+  _noise = noise.gyroNoise;
+  
+  _registers[0x00] = GYRO_ADDR; // WHO_AM_I
+  _registers[0x16] = 0x00; // 256Hz low pass after reset
+}
+
+void SimITG3200::step(double dT){
+  static const double bandwidths[8] = {256, 188, 98, 42, 20, 10, 5, 5}; // By DLPF_CFG
+  _rates = lowPass(_rates, toChip(_model.getRates()) * SIM_DEGREES, bandwidths[_registers[0x16] & 0x07], dT);
+}
+
+void SimITG3200::reading(){
+  putBigEndian(0x1B, -13200 + (SIM_TEMPERATURE / 10.0 - 35) * 280);
+  putBigEndian(0x1D, _rates.x * 14.375 + _bias.x + noise(_noise));
+  putBigEndian(0x1F, _rates.y * 14.375 + _bias.y + noise(_noise));
+  putBigEndian(0x21, _rates.z * 14.375 + _bias.z + noise(_noise));
+}
+
+///////////
+// ADXL345: 256 LSB per g at +-2g, registers 0x32-0x37 are X, Y, Z, low byte first
+
+SimADXL345::SimADXL345(QuadModel &model, std::mt19937 &random, const SensorNoise &noise) : SimChip(model, random){
+  std::uniform_real_distribution<double> bias(-noise.accelBias, noise.accelBias);
+  _bias = Vector3(bias(random), bias(random), bias(random));
+  _noise = noise.accelNoise;
+  _vibration = noise.vibration;
+  
+  _registers[0x00] = 0xE5; // DEVID
+  _registers[0x2C] = 0x0A; // 100Hz
+  _force = Vector3(0, 0, 1);
+}
+
+// Samples at the output data rate set in BW_RATE, so it can't see anything above half of that
+void SimADXL345::step(double dT){
+  double rate = 3200.0 / (1 << (15 - (_registers[0x2C] & 0x0F)));
+  _force = lowPass(_force, toChip(_model.getSpecificForce()) * (1 / MODEL_GRAVITY), rate / 2, dT);
+}
+
+void SimADXL345::reading(){
+  double throttle = 0;
+  for (uint8_t motor = 0; motor < MODEL_MOTORS; motor++){
+    throttle += _model.getMotor(motor) / MODEL_MOTORS;
+  }
+  double deviation = sqrt(_noise * _noise + _vibration * throttle * _vibration * throttle);
+  
+  putLittleEndian(0x32, _force.x * 256 + _bias.x + noise(deviation));
+  putLittleEndian(0x34, _force.y * 256 + _bias.y + noise(deviation));
+  putLittleEndian(0x36, _force.z * 256 + _bias.z + noise(deviation));
+}
+
+///////////
+// HMC5883L: gain set by register 1, registers 0x03-0x08 are X, Z, Y, high byte first
+
+SimHMC5883L::SimHMC5883L(QuadModel &model, std::mt19937 &random, const SensorNoise &noise) : SimChip(model, random){
+  _noise = noise.magNoise;
+  
+  _registers[0x00] = 0x10; // Configuration A, as it comes out of reset
+  _registers[0x01] = 0x20;
+}
+
+void SimHMC5883L::reading(){
+  static const double gains[8] = {1370, 1090, 820, 660, 440, 390, 330, 230}; // LSB per gauss
+  double gain = gains[_registers[0x01] >> 5];
+  Vector3 field = toChip(_model.getAttitude().unrotate(magneticField));
+  
+  putBigEndian(0x03, field.x * gain + noise(_noise));
+  putBigEndian(0x05, field.z * gain + noise(_noise));
+  putBigEndian(0x07, field.y * gain + noise(_noise));
+}
+
+///////////
+// BMP085: writing 0xF4 starts a conversion, the result shows up in 0xF6-0xF8. The calibration in 0xAA-0xBF is
+// the example from the datasheet, and so is the maths below. We run it backwards to find what the chip would
+// have measured.
+
+static const int16_t bmpCalibration[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, -32768, -8711, 2868};
+#define AC1 ((long)bmpCalibration[0])
+#define AC2 ((long)bmpCalibration[1])
+#define AC3 ((long)bmpCalibration[2])
+#define AC4 ((unsigned long)(uint16_t)bmpCalibration[3])
+#define AC5 ((unsigned long)(uint16_t)bmpCalibration[4])
+#define AC6 ((unsigned long)(uint16_t)bmpCalibration[5])
+#define B1 ((long)bmpCalibration[6])
+#define B2 ((long)bmpCalibration[7])
+#define MC ((long)bmpCalibration[9])
+#define MD ((long)bmpCalibration[10])
+
+SimBMP085::SimBMP085(QuadModel &model, std::mt19937 &random, const SensorNoise &noise, double groundAltitude) : SimChip(model, random){
+  _noise = noise.baroNoise;
+  _groundAltitude = groundAltitude;
+  _b5 = 0;
+  
+  for (uint8_t i = 0; i < 11; i++){
+    putBigEndian(0xAA + i * 2, bmpCalibration[i]);
+  }
+  
+  // The datasheet doesn't say what's in register 0, but the driver wants something there
+  _registers[0x00] = 0x55;
+  _registers[0xD0] = 0x55; // Chip ID
+}
+
+void SimBMP085::written(uint8_t address){
+  if (address != 0xF4) return;
+  
+  if (_registers[0xF4] == 0x2E){
+    // Temperature: the smallest reading that comes out at SIM_TEMPERATURE
+    long low = AC6, high = 0xFFFF; // Below AC6 it isn't monotonic
+    while (low < high){
+      long middle = (low + high) / 2;
+      if ((temperature(middle) + 8) >> 4 < SIM_TEMPERATURE) low = middle + 1;
+      else high = middle;
+    }
+    
+    temperature(low); // For _b5
+    _registers[0xF6] = low >> 8;
+    _registers[0xF7] = low & 0xFF;
+  }
+  else{
+    // Pressure at the model's altitude
+    uint8_t oss = (_registers[0xF4] >> 6) & 0x03;
+    double altitude = _groundAltitude - _model.getPosition().z;
+    long target = lround(SIM_SEA_LEVEL * pow(1 - altitude / 44330, 5.255) + noise(_noise));
+    
+    long low = 0, high = (1L << (16 + oss)) - 1;
+    while (low < high){
+      long middle = (low + high) / 2;
+      if (pressure(middle, oss) < target) low = middle + 1;
+      else high = middle;
+    }
+    
+    unsigned long raw = (unsigned long)low << (8 - oss);
+    _registers[0xF6] = raw >> 16;
+    _registers[0xF7] = raw >> 8;
+    _registers[0xF8] = raw;
+  }
+}
+
+// Returns B5, which is 16 times the temperature
+long SimBMP085::temperature(long ut){
+  long x1 = ((ut - (long)AC6) * (long)AC5) >> 15;
+  long x2 = (MC << 11) / (x1 + MD);
+  _b5 = x1 + x2;
+  return _b5;
+}
+
+long SimBMP085::pressure(long up, uint8_t oss){
+  long b6 = _b5 - 4000;
+  long x1 = (B2 * ((b6 * b6) >> 12)) >> 11;
+  long x2 = (AC2 * b6) >> 11;
+  long x3 = x1 + x2;
+  long b3 = (((AC1 * 4 + x3) << oss) + 2) >> 2;
+  
+  x1 = (AC3 * b6) >> 13;
+  x2 = (B1 * ((b6 * b6) >> 12)) >> 16;
+  x3 = ((x1 + x2) + 2) >> 2;
+  unsigned long b4 = (AC4 * (unsigned long)(x3 + 32768)) >> 15;
+  
+  if (up < b3) return -1; // Less than nothing, as far as the search is concerned
+  
+  // 32 bits, like the chip's own reference code
+  uint32_t b7 = (uint32_t)((uint32_t)(up - b3) * (50000UL >> oss));
+  long p = b7 < 0x80000000 ? (b7 * 2) / b4 : (b7 / b4) * 2;
+  
+  x1 = (p >> 8) * (p >> 8);
+  x1 = (x1 * 3038) >> 16;
+  x2 = (-7357 * p) >> 16;
+  return p + ((x1 + x2 + 3791) >> 4);
+}
+
+///////////
+
+SimSensors::SimSensors(QuadModel &model, const SensorNoise &noise, uint32_t seed) :
+  _random(seed),
+  _gyro(model, _random, noise),
+  _accel(model, _random, noise),
+  _mag(model, _random, noise),
+  _baro(model, _random, noise, 100){
+}
+
+void SimSensors::attach(bool baro){
+  halAttachI2C(GYRO_ADDR, &_gyro);
+  halAttachI2C(ACCEL_ADDR, &_accel);
+  halAttachI2C(MAG_ADDR, &_mag);
+  if (baro) halAttachI2C(BARO_ADDR, &_baro);
+}
+
+void SimSensors::detach(){
+  halAttachI2C(GYRO_ADDR, 0);
+  halAttachI2C(ACCEL_ADDR, 0);
+  halAttachI2C(MAG_ADDR, 0);
+  halAttachI2C(BARO_ADDR, 0);
+}
+
+void SimSensors::step(double dT){
+  _gyro.step(dT);
+  _accel.step(dT);
+}
@@ -0,0 +1,147 @@
+/*
+  SimSensors.h - Simulated ITG-3200, ADXL345, HMC5883L and BMP085, on the host's I2C bus
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef SimSensors_h
+#define SimSensors_h
+
+//
+// Each chip answers on the same address and registers as the real one, in the same byte order, so the flight
+// code's drivers read them unchanged. What they measure comes from a QuadModel, plus noise and bias.
+//
+// All four boards are mounted flat with their X axis forward and Y axis to the left (so Z is up). In the model's
+// front-right-down terms, that's (x, -y, -z).
+//
+
+#include <stdint.h>
+#include <random>
+
+#include "HAL.h"
+#include "QuadModel.h"
+
+struct SensorNoise {
+  double gyroNoise; // Standard deviations, in LSBs
+  double gyroBias; // Up to this much, per axis, for the whole run
+  double accelNoise;
+  double accelBias;
+  double vibration; // Extra accel noise at full throttle
+  double magNoise;
+  double baroNoise; // Pa
+  
+  SensorNoise();
+  static SensorNoise none();
+};
+
+// A register file with an auto-incrementing pointer, which is how all four of them work
+class SimChip : public HalI2CDevice
+{
+  public:
+    SimChip(QuadModel &model, std::mt19937 &random);
+    
+    void write(const uint8_t *data, uint8_t length);
+    uint8_t read(uint8_t *data, uint8_t length);
+    
+    virtual void step(double dT){}
+    
+  protected:
+    QuadModel &_model;
+    std::mt19937 &_random;
+    uint8_t _registers[256];
+    uint8_t _pointer;
+    
+    virtual void written(uint8_t address){} // After a register write
+    virtual void reading(){} // Before a read, to put fresh data in the registers
+    
+    double noise(double deviation);
+    void putBigEndian(uint8_t address, double value);
+    void putLittleEndian(uint8_t address, double value);
+};
+
+class SimITG3200 : public SimChip
+{
+  public:
+    SimITG3200(QuadModel &model, std::mt19937 &random, const SensorNoise &noise);
+    void step(double dT);
+    
+  private:
+    Vector3 _rates; // After the low pass filter, chip axes, degrees/s
+    Vector3 _bias;
+    double _noise;
+    
+    void reading();
+};
+
+class SimADXL345 : public SimChip
+{
+  public:
+    SimADXL345(QuadModel &model, std::mt19937 &random, const SensorNoise &noise);
+    void step(double dT);
+    
+  private:
+    Vector3 _force; // After the low pass filter, chip axes, g
+    Vector3 _bias;
+    double _noise;
+    double _vibration;
+    
+    void reading();
+};
+
+class SimHMC5883L : public SimChip
+{
+  public:
+    SimHMC5883L(QuadModel &model, std::mt19937 &random, const SensorNoise &noise);
+    
+  private:
+    double _noise;
+    
+    void reading();
+};
+
+class SimBMP085 : public SimChip
+{
+  public:
+    SimBMP085(QuadModel &model, std::mt19937 &random, const SensorNoise &noise, double groundAltitude);
+    
+  private:
+    double _noise;
+    double _groundAltitude;
+    long _b5; // The datasheet's name for it: temperature, as the pressure maths wants it
+    
+    void written(uint8_t address);
+    long temperature(long ut);
+    long pressure(long up, uint8_t oss);
+};
+
+// All four, plugged in
+class SimSensors
+{
+  public:
+    SimSensors(QuadModel &model, const SensorNoise &noise, uint32_t seed);
+    
+    void attach(bool baro); // The baro blocks loop() for 31ms, so it can be left out
+    void detach();
+    void step(double dT);
+    
+  private:
+    std::mt19937 _random;
+    SimITG3200 _gyro;
+    SimADXL345 _accel;
+    SimHMC5883L _mag;
+    SimBMP085 _baro;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+  Sketch.h - Prototypes for the functions in the .pde files, for the host build
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef Sketch_h
+#define Sketch_h
+
+//
+// The Arduino IDE writes these itself when it glues the .pde files together. The host build does the gluing in
+// host/sketch.cmake, and includes this instead. Keep it in step with the .pde files.
+//
+
+#include "WProgram.h"
+
+class PID;
+
+// QuadCopter.pde
+void setup();
+void loop();
+
+// FlightCommand.pde
+void processFlightCommand();
+void processReceiverCommands();
+void processFailsafe();
+void processAutoPilot();
+
+// FlightControl.pde
+void processFlightControl();
+void recordBlackbox(float rollAdjust, float pitchAdjust, float headingAdjust);
+void processAutotune();
+void applyAutotune(byte id, PID &pid);
+
+// Parameters.pde
+float getParameter(byte id);
+boolean setParameter(byte id, float value);
+void resetParameters();
+void saveParameters();
+void loadParameters();
+void saveConfig(boolean force);
+void updateConfig();
+
+// SerialControl.pde
+byte serialArgCount(byte command);
+void readSerialCommand();
+void applySerialCommand(byte command);
+boolean isSerialStream(byte stream);
+void subscribeSerialStream(byte stream, int rate);
+void sendSerialTelemetry();
+void sendSerialQuery(byte queryType);
+void sendAsciiTelemetry();
+void sendBinaryTelemetry();
+boolean sendBlackboxChunk();
+float readFloatSerial();
+int readIntSerial();
+char readCharSerial();
+void serialPrintValueComma(float val);
+void serialPrintValueComma(double val);
+void serialPrintValueComma(char val);
+void serialPrintValueComma(int val);
+void serialPrintValueComma(unsigned long val);
+void serialComma();
+void serialPrintPID(PID pid);
+void readSerialPID(byte id);
+
+#endif
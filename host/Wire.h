@@ -0,0 +1,56 @@
+/*
+  Wire.h - I2C for the host build, talking to whatever HAL devices are attached
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "WProgram.h"
+
+#define BUFFER_LENGTH 32
+
+// Same interface as the 0022 Wire library. Transmissions go to the HalI2CDevice at that address, if there is one
+class TwoWire
+{
+  public:
+    TwoWire();
+    
+    void begin();
+    void beginTransmission(uint8_t);
+    void beginTransmission(int);
+    uint8_t endTransmission();
+    uint8_t requestFrom(uint8_t, uint8_t);
+    uint8_t requestFrom(int, int);
+    void send(uint8_t);
+    void send(uint8_t *, uint8_t);
+    void send(int);
+    void send(char *);
+    uint8_t available();
+    uint8_t receive();
+    
+  private:
+    uint8_t _address;
+    uint8_t _txBuffer[BUFFER_LENGTH];
+    uint8_t _txLength;
+    uint8_t _rxBuffer[BUFFER_LENGTH];
+    uint8_t _rxIndex;
+    uint8_t _rxLength;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,30 @@
+/*
+  interrupt.h - Interrupts for the host build
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef HAL_interrupt_h
+#define HAL_interrupt_h
+
+#include <avr/io.h>
+
+// A handler is just a function, which halInterrupts() calls when the hardware would have
+#define ISR(vector) extern "C" void vector(void)
+
+inline void cli(){ SREG &= ~_BV(SREG_I); }
+inline void sei(){ SREG |= _BV(SREG_I); }
+
+#endif
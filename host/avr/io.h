@@ -0,0 +1,181 @@
+/*
+  io.h - ATmega2560 registers for the host build
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef HAL_io_h
+#define HAL_io_h
+
+//
+// Only the registers the flight code touches. Most are just storage, but HAL.cpp hooks the ones that do something
+// when read or written: the timer counters follow the clock, EECR reads and writes the EEPROM, SPDR clocks a byte
+// through an SPI bus with nothing on it, and so on.
+//
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+template <typename T>
+class HalRegister
+{
+  public:
+    typedef T (*ReadHook)(T value);
+    typedef void (*WriteHook)(T previous, T value);
+    
+    constexpr HalRegister() : _value(0), _read(0), _write(0) {}
+    
+    operator T() const { return _read ? _read(_value) : _value; }
+    HalRegister &operator=(T value){ set(value); return *this; }
+    HalRegister &operator|=(long bits){ set(_value | bits); return *this; }
+    HalRegister &operator&=(long bits){ set(_value & bits); return *this; }
+    HalRegister &operator^=(long bits){ set(_value ^ bits); return *this; }
+    
+    // For HAL.cpp: what's really in the register, and what happens when it's used
+    T raw() const { return _value; }
+    void setRaw(T value){ _value = value; }
+    void hook(ReadHook read, WriteHook write){ _read = read; _write = write; }
+    
+  private:
+    T _value;
+    ReadHook _read;
+    WriteHook _write;
+    
+    void set(T value){
+      T previous = _value;
+      _value = value;
+      if (_write) _write(previous, value);
+    }
+};
+
+typedef HalRegister<uint8_t> HalRegister8;
+typedef HalRegister<uint16_t> HalRegister16;
+
+// Status
+extern HalRegister8 SREG;
+#define SREG_I 7
+
+// Timers
+extern HalRegister8 GTCCR;
+extern HalRegister8 TCCR1A, TCCR1B, TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+extern HalRegister8 TIMSK1, TIMSK3, TIMSK4, TIMSK5;
+extern HalRegister16 TCNT1, TCNT3, TCNT4, TCNT5;
+extern HalRegister16 ICR3, ICR4, ICR5;
+extern HalRegister16 OCR3A, OCR3B, OCR3C, OCR4A, OCR4B, OCR4C;
+
+#define TSM 7
+#define PSRSYNC 0
+
+#define COM3A1 7
+#define COM3B1 5
+#define COM3C1 3
+#define WGM31 1
+#define WGM30 0
+#define WGM33 4
+#define WGM32 3
+#define CS32 2
+#define CS31 1
+#define CS30 0
+#define TOIE3 0
+
+#define COM4A1 7
+#define COM4B1 5
+#define COM4C1 3
+#define WGM41 1
+#define WGM40 0
+#define WGM43 4
+#define WGM42 3
+#define CS42 2
+#define CS41 1
+#define CS40 0
+#define TOIE4 0
+
+#define CS12 2
+#define CS11 1
+#define CS10 0
+#define TOIE1 0
+
+#define ICNC5 7
+#define ICES5 6
+#define CS52 2
+#define CS51 1
+#define CS50 0
+#define ICIE5 5
+
+// ADC
+extern HalRegister8 ADCSRA, ADCSRB, ADMUX;
+extern HalRegister16 ADC;
+
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define MUX5 3
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+#define REFS1 7
+#define REFS0 6
+
+// USARTs
+extern HalRegister8 UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern HalRegister8 UCSR1A, UCSR1B, UCSR1C, UDR1;
+
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UPM11 5
+#define UPM10 4
+#define USBS1 3
+#define UCSZ11 2
+#define UCSZ10 1
+
+// EEPROM
+extern HalRegister8 EECR, EEDR;
+extern HalRegister16 EEAR;
+
+#define EERIE 3
+#define EEMPE 2
+#define EEPE 1
+#define EERE 0
+
+// Pin change interrupts
+extern HalRegister8 PCICR, PCMSK2, PINK;
+
+#define PCIE2 2
+
+// SPI
+extern HalRegister8 SPCR, SPSR, SPDR;
+
+#define SPIE 7
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPIF 7
+#define WCOL 6
+#define SPI2X 0
+
+#endif
@@ -0,0 +1,92 @@
+/*
+  bench.cpp - Time the flight code's hot kernels on the host
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// bench [-n calls] [kernel...]
+//
+// The same microbenchmarks the 'm' serial command runs on the board (see Benchmark.cpp), as CSV on stdout:
+// kernel,calls,per_call,unit, where the unit is nanoseconds here and cycles there. Without any kernels it runs them
+// all.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "WProgram.h"
+#include "Benchmark.h"
+
+static void usage(){
+  fprintf(stderr, "usage: bench [-n calls] [kernel...]\n");
+  exit(1);
+}
+
+static bool wanted(const char *name, int argc, char **argv){
+  if (optind == argc) return true;
+  
+  for (int i = optind; i < argc; i++){
+    if (!strcmp(argv[i], name)) return true;
+  }
+  
+  return false;
+}
+
+int main(int argc, char **argv){
+  unsigned long calls = BENCHMARK_CALLS;
+  
+  int opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1){
+    switch (opt){
+      case 'n':
+        calls = strtoul(optarg, 0, 10);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (!calls) usage();
+  
+  // Anything asked for that doesn't exist
+  for (int i = optind; i < argc; i++){
+    bool found = false;
+    for (byte kernel = 0; kernel < BENCHMARK_COUNT; kernel++){
+      char name[BENCHMARK_NAME_LENGTH];
+      benchmarkName(kernel, name);
+      if (!strcmp(argv[i], name)) found = true;
+    }
+    
+    if (!found){
+      fprintf(stderr, "bench: no kernel called %s\n", argv[i]);
+      return 1;
+    }
+  }
+  
+  printf("kernel,calls,per_call,unit\n");
+  for (byte kernel = 0; kernel < BENCHMARK_COUNT; kernel++){
+    char name[BENCHMARK_NAME_LENGTH];
+    benchmarkName(kernel, name);
+    if (!wanted(name, argc, argv)) continue;
+    
+    printf("%s,%lu,%.1f,%s\n", name, calls, benchmarkRun(kernel, calls), BENCHMARK_UNIT);
+    fflush(stdout);
+  }
+  
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+  main.cpp - Runs the flight code on the host, with the serial port on stdin/stdout
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// quadcopter [-n loops] [-t us] [-r]
+//
+// Nothing is plugged in, so the sensors all fail to answer, but everything else runs: the serial protocol,
+// parameters, EEPROM, blackbox... Each loop is -t microseconds apart in simulated time (2500 by default), or with
+// -r it runs against the real clock instead.
+//
+// In simulated time, all of stdin is read before the first loop, and serial port 0 hands it over at its baud rate,
+// so a piped script gets the same replies every run. Without -n it runs until the sketch has read all of it. With -r,
+// stdin is polled as the loop goes, and without -n it runs until stdin closes.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "WProgram.h"
+#include "HAL.h"
+#include "Sketch.h"
+#include "Definitions.h"
+
+#define HOST_LOOP_TIME 2500
+#define HOST_BATTERY 703 // ADC counts for 11.1V through the battery divider
+
+class RealClock : public HalClock
+{
+  public:
+    RealClock(){
+      _start = now();
+    }
+    
+    unsigned long micros(){
+      return now() - _start;
+    }
+    
+    void wait(unsigned long us){
+      struct timespec delay = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+      nanosleep(&delay, 0);
+    }
+    
+  private:
+    unsigned long long _start;
+    
+    unsigned long long now(){
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+};
+
+static void usage(){
+  fprintf(stderr, "usage: quadcopter [-n loops] [-t us] [-r]\n");
+  exit(1);
+}
+
+// Whatever has turned up on stdin goes down the wire to serial port 0. Returns false once stdin has closed
+static bool readInput(){
+  uint8_t buffer[64];
+  ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+  
+  if (length > 0) halSerialInput(0, buffer, length);
+  return length != 0;
+}
+
+// All of stdin down the wire at once. How much arrives by when is then down to the baud rate, not how fast we poll
+static void readAllInput(){
+  while (readInput());
+}
+
+int main(int argc, char **argv){
+  unsigned long loops = 0;
+  unsigned long loopTime = HOST_LOOP_TIME;
+  bool realTime = false;
+  
+  int opt;
+  while ((opt = getopt(argc, argv, "n:t:r")) != -1){
+    switch (opt){
+      case 'n':
+        loops = strtoul(optarg, 0, 10);
+        break;
+      case 't':
+        loopTime = strtoul(optarg, 0, 10);
+        break;
+      case 'r':
+        realTime = true;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind != argc) usage();
+  
+  RealClock realClock;
+  if (realTime) halSetClock(&realClock);
+  
+  if (realTime) fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+  else readAllInput();
+  
+  halSerialEcho(0, stdout);
+  halSetAnalog(BATTERY_PIN, HOST_BATTERY);
+  
+  setup();
+  
+  bool reading = true;
+  for (unsigned long i = 0; (loops ? i < loops : reading); i++){
+    if (realTime) reading = reading && readInput();
+    else reading = halSerialPending(0) > 0;
+    
+    loop();
+    
+    if (realTime) realClock.wait(loopTime);
+    else halAdvance(loopTime);
+    halInterrupts();
+  }
+  
+  return 0;
+}
@@ -0,0 +1,489 @@
+/*
+  pidsweep.cpp - Searches for PID gains over thousands of simulated flights, on every core
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// pidsweep [-j threads] [-n candidates] [-g steps] [-r repeats] [-l us] [-s seed] [-q]
+//
+// Unlike quadsim, which runs the whole sketch (so one flight per process), this flies the attitude loop on its own:
+// the real IMU, PID and Mixer classes, the control step from Control.cpp and the real accel angle and compass maths,
+// with the sensor readings handed straight to them instead of going through the drivers and I2C. All of that is
+// per-instance, so any number of flights can share the process, one per thread. Flights are spread across -j
+// threads (every core by default), and a thread that runs out steals from the others.
+//
+// Each candidate is a set of level gains (the same for roll and pitch, the frame is symmetric), heading hold gains
+// and an IMU bias, picked at random inside the bounds below (-n of them, 500 by default), or on a grid of -g steps
+// across the bounds of every one. The bias is in there because it decides more than the gains do: at the default
+// 0.96 the accelerometer wins within a few loops, and it can't tell a steady tilt from level, so nothing stops a
+// step from carrying on over. Each candidate flies every scenario -r times (2 by default), each time with different
+// sensor noise (-q for none), and every candidate gets the same noise. A flight takes off and holds 2m with the
+// throttle, loops every -l microseconds (3000 by default), and the scenario starts at 2s and runs for 8s:
+//
+//   roll, pitch  A 15 degree step, held for 1s and then back to level
+//   yaw          A 30 degree heading step, held
+//   gust         Knocked in roll and pitch at once
+//
+// Roll and pitch come back to level because the accelerometer can't see a steady tilt: held for long, the estimate
+// creeps back to level while the quad doesn't, and no gains settle. Level, it can.
+//
+// A candidate is scored on its worst flight for overshoot (percent of the step, while it's held) and settling
+// (seconds after the last change until it stays within 2 degrees or 10% of the step), and on its average saturation (the fraction of loops with an engine
+// pinned at its limit). Anything that crashed is out, and so is anything still outside the band in the last 2s of
+// any flight: it never settled, and its settling time would only be the length of the scenario. The ones on the
+// Pareto front, where nothing else does better on one score without doing worse on another, go to stdout as serial
+// commands, ready to paste (send W afterwards to keep them):
+//
+//   E<p>;<i>;<d>;<p>;<i>;<d>;q6;<p>;q7;<i>;q8;<d>;q13;<bias>;
+//
+// The level gains go to roll and pitch with 'E', and the heading gains and the bias as parameters. Their scores go to
+// stderr, in the same order.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "QuadModel.h"
+#include "SimSensors.h"
+
+#include "WProgram.h"
+#include "Definitions.h"
+#include "Parameters.h"
+#include "Accel.h"
+#include "Mag.h"
+#include "IMU.h"
+#include "PID.h"
+#include "Mixer.h"
+#include "Control.h"
+#include "Utils.h"
+
+#define SWEEP_STEP 250 // Physics step, in microseconds
+#define SWEEP_LOOP_TIME 3000
+#define SWEEP_CANDIDATES 500
+#define SWEEP_REPEATS 2
+#define SWEEP_ALTITUDE 2.0 // Meters
+#define SWEEP_TAKEOFF 2.0 // Seconds from the start of a flight to the start of its scenario
+#define SWEEP_SETTLE_BAND 2.0 // Degrees
+#define SWEEP_SETTLED 2.0 // Seconds at the end of a flight it has to spend inside the band to have settled at all
+#define SWEEP_MAG_GAIN 1090 // LSB per gauss, at the 1.0 gauss scale Mag::init() sets
+#define SWEEP_SETTINGS 7
+
+#define SWEEP_DEGREES (180.0 / M_PI)
+
+static const Vector3 magneticField(0.19, 0.0, 0.47); // Gauss, north-east-down, like SimSensors
+
+// Where candidates come from: level P, I, D, heading P, I, D, then the IMU bias
+static const double settingBounds[SWEEP_SETTINGS][2] = {
+  { 1.0, 15.0 },
+  { 0.0, 2.0 },
+  { 0.0, 3.0 },
+  { 0.5, 12.0 },
+  { 0.0, 1.0 },
+  { 0.0, 2.0 },
+  { 0.96, 0.999 }
+};
+
+///////////
+
+//
+// A pool of threads for a fixed list of jobs. Each thread starts with its own share, works from the back of it, and
+// when that's gone steals from the front of someone else's. Nothing is added once it starts, so a thread that finds
+// every queue empty is done.
+//
+class WorkPool
+{
+  public:
+    WorkPool(unsigned threads) : _queues(threads) {}
+    
+    void run(size_t jobs, const std::function<void(size_t)> &work){
+      for (size_t job = 0; job < jobs; job++){
+        _queues[job * _queues.size() / jobs].jobs.push_back(job);
+      }
+      
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < _queues.size(); i++){
+        threads.push_back(std::thread(&WorkPool::worker, this, i, std::cref(work)));
+      }
+      for (size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+      }
+    }
+    
+  private:
+    struct Queue {
+      std::mutex lock;
+      std::deque<size_t> jobs;
+    };
+    
+    std::vector<Queue> _queues;
+    
+    void worker(size_t self, const std::function<void(size_t)> &work){
+      size_t job;
+      while (take(self, job)) work(job);
+    }
+    
+    bool take(size_t self, size_t &job){
+      for (size_t i = 0; i < _queues.size(); i++){
+        size_t victim = (self + i) % _queues.size();
+        Queue &queue = _queues[victim];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) continue;
+        
+        if (victim == self){
+          job = queue.jobs.back();
+          queue.jobs.pop_back();
+        }
+        else{
+          job = queue.jobs.front();
+          queue.jobs.pop_front();
+        }
+        return true;
+      }
+      
+      return false;
+    }
+};
+
+///////////
+
+struct Candidate {
+  double settings[SWEEP_SETTINGS];
+  
+  bool crashed;
+  bool settled; // Every flight settled
+  double overshoot; // Percent, worst of its flights
+  double settle; // Seconds, worst of its flights
+  double saturation; // Fraction of loops, average of its flights
+};
+
+struct Flight {
+  bool crashed;
+  bool settled;
+  double overshoot;
+  double settle;
+  double saturation;
+};
+
+struct Scenario {
+  const char *name;
+  int axis; // ROLL, PITCH or YAW to step, -1 for a gust instead
+  double step; // Degrees
+  double hold; // Seconds until the step goes back to 0, 0 to keep it
+  double length; // Seconds
+};
+
+static const Scenario scenarios[] = {
+  { "roll", ROLL, 15, 1, 8 },
+  { "pitch", PITCH, 15, 1, 8 },
+  { "yaw", YAW, 30, 0, 8 },
+  { "gust", -1, 0, 0, 8 }
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// Body front-right-down into the boards' x forward, y left, z up
+static Vector3 toChip(const Vector3 &body){
+  return Vector3(body.x, -body.y, -body.z);
+}
+
+static double wrap180(double angle){
+  while (angle > 180) angle -= 360;
+  while (angle <= -180) angle += 360;
+  return angle;
+}
+
+// One flight, doing what loop() does on every pass while armed, minus the I2C
+static Flight fly(const double *settings, const Scenario &scenario, uint32_t seed, const SensorNoise &noise, unsigned long loopTime){
+  QuadModel model((QuadParameters()));
+  model.reset(0);
+  
+  std::mt19937 random(seed);
+  std::normal_distribution<double> gaussian(0.0, 1.0);
+  
+  IMU imu;
+  PID levelRollPID(settings[0], settings[1], settings[2]);
+  PID levelPitchPID(settings[0], settings[1], settings[2]);
+  PID headingHoldPID(settings[3], settings[4], settings[5]);
+  Mixer mixer;
+  Accel accel;
+  Mag mag;
+  imu.setBias(settings[6]);
+  
+  float smoothed[3] = {0, 0, 1}; // What Accel::updateAll() keeps, in Gs
+  uint16_t pulses[MODEL_MOTORS] = {0};
+  
+  double hover = model.getHoverPulse();
+  double end = SWEEP_TAKEOFF + scenario.length;
+  double released = SWEEP_TAKEOFF + scenario.hold; // Where settling is timed from
+  double band = fmax(SWEEP_SETTLE_BAND, fabs(scenario.step) * 0.1);
+  double dT = loopTime / 1000000.0;
+  
+  Flight flight = {false, false, 0, 0, 0};
+  unsigned long loops = 0, saturated = 0;
+  double lastOutside = released;
+  
+  while (model.getTime() < end){
+    double t = model.getTime();
+    if (scenario.axis < 0 && t < SWEEP_TAKEOFF && t + dT >= SWEEP_TAKEOFF) model.push(Vector3(0.3, 0.3, 0), 0.1);
+    
+    for (unsigned long us = 0; us < loopTime; us += SWEEP_STEP){
+      model.step(pulses, SWEEP_STEP / 1000000.0);
+    }
+    t = model.getTime();
+    
+    // What Gyro, Accel and Mag would make of it, as in SimSensors, less the biases calibration takes out
+    const Vector3 &rates = model.getRates();
+    double gyroNoise = noise.gyroNoise / 14.375 / SWEEP_DEGREES; // rad/s, which is what Gyro hands over
+    float gyroRoll = -rates.x + gaussian(random) * gyroNoise;
+    float gyroPitch = -rates.y + gaussian(random) * gyroNoise;
+    float gyroYaw = rates.z + gaussian(random) * gyroNoise;
+    
+    double throttle = 0;
+    for (uint8_t motor = 0; motor < MODEL_MOTORS; motor++){
+      throttle += model.getMotor(motor) / MODEL_MOTORS;
+    }
+    double accelNoise = sqrt(noise.accelNoise * noise.accelNoise + noise.vibration * throttle * noise.vibration * throttle) / 256;
+    Vector3 force = model.getSpecificForce() * (1 / MODEL_GRAVITY);
+    smoothed[XAXIS] = filterSmooth(-force.x + gaussian(random) * accelNoise, smoothed[XAXIS], accel.getSmoothFactor());
+    smoothed[YAXIS] = filterSmooth(force.y + gaussian(random) * accelNoise, smoothed[YAXIS], accel.getSmoothFactor());
+    smoothed[ZAXIS] = filterSmooth(-force.z + gaussian(random) * accelNoise, smoothed[ZAXIS], accel.getSmoothFactor());
+    accel.setSmoothed(smoothed[XAXIS], smoothed[YAXIS], smoothed[ZAXIS]);
+    
+    Vector3 field = toChip(model.getAttitude().unrotate(magneticField)) * SWEEP_MAG_GAIN;
+    mag.compensate(lround(field.x + gaussian(random) * noise.magNoise), lround(field.y + gaussian(random) * noise.magNoise),
+      lround(field.z + gaussian(random) * noise.magNoise), accel.getYAngle(), accel.getXAngle());
+    
+    imu.update(loopTime / 1000, gyroRoll, gyroPitch, gyroYaw, accel.getYAngle(), accel.getXAngle(), accel.getZAngle(), mag.getHeadingDegrees());
+    
+    // The pilot holds the altitude, and steps once the scenario starts
+    double altitude = -model.getPosition().z;
+    double climb = -model.getVelocity().z;
+    int stick = constrain(hover + 60 * (SWEEP_ALTITUDE - altitude) - 80 * climb, 1100.0, 1900.0);
+    
+    float target[3] = {0, 0, 0};
+    if (scenario.axis >= 0 && t >= SWEEP_TAKEOFF && (!scenario.hold || t < released)) target[scenario.axis] = scenario.step;
+    
+    // processFlightControl()
+    float current[3] = {imu.getRoll(), imu.getPitch(), imu.getHeading()};
+    if (controlPanic(current[ROLL], current[PITCH])){
+      flight.crashed = true;
+      break;
+    }
+    
+    float adjust[3];
+    controlAttitude(&levelRollPID, &levelPitchPID, &headingHoldPID, target, current, dT, adjust);
+    mixer.mix(stick, adjust[ROLL], adjust[PITCH], adjust[YAW]);
+    
+    bool pinned = false;
+    for (byte engine = 0; engine < ENGINE_COUNT; engine++){
+      int output = constrain(mixer.getOutput(engine), MIN_MOTOR_SPEED, MAX_MOTOR_SPEED);
+      if (output <= MIN_MOTOR_SPEED || output >= MAX_MOTOR_SPEED) pinned = true;
+      pulses[engine] = output;
+    }
+    
+    if (t < SWEEP_TAKEOFF) continue;
+    
+    // Scored on where it really is, in the flight code's terms
+    const Quaternion &attitude = model.getAttitude();
+    double actual[3] = {-attitude.getRoll() * SWEEP_DEGREES, -attitude.getPitch() * SWEEP_DEGREES, attitude.getYaw() * SWEEP_DEGREES};
+    
+    // Back on the ground, or upside down, whatever the flight code thinks
+    if (model.getPosition().z >= 0 || fabs(actual[ROLL]) > 90 || fabs(actual[PITCH]) > 90){
+      flight.crashed = true;
+      break;
+    }
+    
+    for (int axis = ROLL; axis <= YAW; axis++){
+      bool scored = scenario.axis < 0 ? axis != YAW : axis == scenario.axis;
+      if (!scored) continue;
+      
+      double error = wrap180(actual[axis] - target[axis]);
+      if (t >= released && fabs(error) > band) lastOutside = t;
+      if (target[axis]) flight.overshoot = fmax(flight.overshoot, error * 100 / scenario.step);
+    }
+    
+    loops++;
+    if (pinned) saturated++;
+  }
+  
+  flight.settle = lastOutside - released;
+  flight.settled = !flight.crashed && lastOutside < end - SWEEP_SETTLED;
+  flight.saturation = loops ? (double)saturated / loops : 0;
+  return flight;
+}
+
+///////////
+
+// Is a at least as good as b at everything, and better at something?
+static bool dominates(const Candidate &a, const Candidate &b){
+  if (a.overshoot > b.overshoot || a.settle > b.settle || a.saturation > b.saturation) return false;
+  return a.overshoot < b.overshoot || a.settle < b.settle || a.saturation < b.saturation;
+}
+
+static void usage(){
+  fprintf(stderr, "usage: pidsweep [-j threads] [-n candidates] [-g steps] [-r repeats] [-l us] [-s seed] [-q]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv){
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned long count = SWEEP_CANDIDATES;
+  unsigned long grid = 0;
+  unsigned long repeats = SWEEP_REPEATS;
+  unsigned long loopTime = SWEEP_LOOP_TIME;
+  uint32_t seed = 1;
+  SensorNoise noise;
+  
+  int opt;
+  while ((opt = getopt(argc, argv, "j:n:g:r:l:s:q")) != -1){
+    switch (opt){
+      case 'j':
+        threads = strtoul(optarg, 0, 10);
+        break;
+      case 'n':
+        count = strtoul(optarg, 0, 10);
+        break;
+      case 'g':
+        grid = strtoul(optarg, 0, 10);
+        if (grid < 2) usage();
+        break;
+      case 'r':
+        repeats = strtoul(optarg, 0, 10);
+        break;
+      case 'l':
+        loopTime = strtoul(optarg, 0, 10);
+        break;
+      case 's':
+        seed = strtoul(optarg, 0, 10);
+        break;
+      case 'q':
+        noise = SensorNoise::none();
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind != argc || !repeats || loopTime < 1000) usage();
+  if (!threads) threads = 1;
+  
+  std::vector<Candidate> candidates;
+  if (grid){
+    unsigned long total = 1;
+    for (uint8_t setting = 0; setting < SWEEP_SETTINGS; setting++) total *= grid;
+    
+    for (unsigned long i = 0; i < total; i++){
+      Candidate candidate;
+      unsigned long index = i;
+      for (uint8_t setting = 0; setting < SWEEP_SETTINGS; setting++){
+        const double *bounds = settingBounds[setting];
+        candidate.settings[setting] = bounds[0] + (bounds[1] - bounds[0]) * (index % grid) / (grid - 1);
+        index /= grid;
+      }
+      candidates.push_back(candidate);
+    }
+  }
+  else{
+    std::mt19937 random(seed);
+    for (unsigned long i = 0; i < count; i++){
+      Candidate candidate;
+      for (uint8_t setting = 0; setting < SWEEP_SETTINGS; setting++){
+        std::uniform_real_distribution<double> pick(settingBounds[setting][0], settingBounds[setting][1]);
+        candidate.settings[setting] = pick(random);
+      }
+      candidates.push_back(candidate);
+    }
+  }
+  if (candidates.empty()) usage();
+  
+  // One job per flight, each with its own slot for the result
+  size_t perCandidate = SCENARIO_COUNT * repeats;
+  std::vector<Flight> flights(candidates.size() * perCandidate);
+  
+  std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+  
+  WorkPool pool(threads);
+  pool.run(flights.size(), [&](size_t job){
+    const Candidate &candidate = candidates[job / perCandidate];
+    size_t run = job % perCandidate;
+    const Scenario &scenario = scenarios[run % SCENARIO_COUNT];
+    
+    flights[job] = fly(candidate.settings, scenario, seed + run, noise, loopTime);
+  });
+  
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+  
+  size_t crashed = 0, unsettled = 0;
+  for (size_t i = 0; i < candidates.size(); i++){
+    Candidate &candidate = candidates[i];
+    candidate.crashed = false;
+    candidate.settled = true;
+    candidate.overshoot = candidate.settle = candidate.saturation = 0;
+    
+    for (size_t run = 0; run < perCandidate; run++){
+      const Flight &flight = flights[i * perCandidate + run];
+      candidate.crashed = candidate.crashed || flight.crashed;
+      candidate.settled = candidate.settled && flight.settled;
+      candidate.overshoot = fmax(candidate.overshoot, flight.overshoot);
+      candidate.settle = fmax(candidate.settle, flight.settle);
+      candidate.saturation += flight.saturation / perCandidate;
+    }
+    
+    if (candidate.crashed) crashed++;
+    else if (!candidate.settled) unsettled++;
+  }
+  
+  std::vector<const Candidate *> front;
+  for (size_t i = 0; i < candidates.size(); i++){
+    if (candidates[i].crashed || !candidates[i].settled) continue;
+    
+    bool dominated = false;
+    for (size_t j = 0; j < candidates.size() && !dominated; j++){
+      dominated = !candidates[j].crashed && candidates[j].settled && dominates(candidates[j], candidates[i]);
+    }
+    if (!dominated) front.push_back(&candidates[i]);
+  }
+  std::sort(front.begin(), front.end(), [](const Candidate *a, const Candidate *b){ return a->settle < b->settle; });
+  
+  fprintf(stderr, "%lu flights of %lu candidates in %.1fs on %u threads, %lu crashed, %lu never settled, %lu on the front\n",
+    (unsigned long)flights.size(), (unsigned long)candidates.size(), wall, threads, (unsigned long)crashed, (unsigned long)unsettled,
+    (unsigned long)front.size());
+  fprintf(stderr, "%9s %8s %10s   %6s %6s %6s   %6s %6s %6s   %6s\n", "overshoot", "settle", "saturation", "P", "I", "D", "headP", "headI", "headD", "bias");
+  fprintf(stderr, "%9s %8s %10s\n", "(%)", "(s)", "(%)");
+  
+  for (size_t i = 0; i < front.size(); i++){
+    const Candidate &candidate = *front[i];
+    const double *settings = candidate.settings;
+    
+    fprintf(stderr, "%9.1f %8.2f %10.1f   %6.2f %6.3f %6.3f   %6.2f %6.3f %6.3f   %6.4f\n", candidate.overshoot, candidate.settle,
+      candidate.saturation * 100, settings[0], settings[1], settings[2], settings[3], settings[4], settings[5], settings[6]);
+    printf("E%.2f;%.3f;%.3f;%.2f;%.3f;%.3f;q%d;%.2f;q%d;%.3f;q%d;%.3f;q%d;%.4f;\n", settings[0], settings[1], settings[2], settings[0],
+      settings[1], settings[2], PARAM_HEADING_P, settings[3], PARAM_HEADING_I, settings[4], PARAM_HEADING_D, settings[5], PARAM_IMU_BIAS,
+      settings[6]);
+  }
+  
+  return 0;
+}
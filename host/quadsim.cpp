@@ -0,0 +1,493 @@
+/*
+  quadsim.cpp - Flies the flight code against a simulated quad, faster than real time
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// quadsim [-l us] [-s seed] [-b] [-q] [-v] [-c commands] [scenario...]
+//
+// Runs the real setup() and loop() against QuadModel, with SimSensors on the I2C bus, a simulated pilot on the
+// receiver pins, and the ESC pulses read back out of the timer compare registers. Time is simulated, in lockstep:
+// physics moves on only when the flight code waits (delay()) or finishes a loop, which counts as -l microseconds
+// (3000 by default, a guess at the board's own compute time).
+//
+// Each scenario starts from power on, in its own process. Once setup() is done, the pilot calibrates the
+// accelerometer, arms at 2s, takes off at 3s to 2m (and holds it there with the throttle), then flies the scenario
+// from 6s. For the scenario part, we report:
+//
+//   rms, max   Roll and pitch tracking error, the real attitude against what the flight code was aiming for
+//   estimate   RMS error of the flight code's idea of its attitude
+//   settle     Longest time to get back within 2 degrees (or 10% of the step) after a step or a gust
+//   loop       Mean time between loops, as the flight code measured it
+//   cpu        Host time per loop(), less the simulation's own, to compare changes by
+//   speed      Simulated seconds per real second
+//
+// A scenario that crashes fails: it disarmed after taking off (a panic, or it never armed), turned past 90 degrees
+// of roll or pitch, or came back down to the ground. Then we only say when and how, and exit non-zero.
+//
+// -b leaves the barometer unplugged. -q turns off sensor noise and bias. -v writes every loop to stderr as CSV:
+// time, then target, real and estimated roll, pitch and heading (in the flight code's terms), altitude and the four
+// engine commands. -c sends serial commands at 1s, on the ground with the sensors running but before arming (e.g.
+// "n" to measure the telemetry), and writes whatever comes back until takeoff to stdout.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <vector>
+
+#include "QuadModel.h"
+#include "SimSensors.h"
+
+#include "WProgram.h"
+#include "HAL.h"
+#include "Sketch.h"
+#include "Definitions.h"
+#include "Engines.h"
+
+#define SIM_STEP 250 // Physics step, in microseconds
+#define SIM_LOOP_COST 3000
+#define SIM_BATTERY 703 // ADC counts for 11.1V through the battery divider
+#define SIM_ALTITUDE 2.0 // Where the pilot holds it, in meters
+#define SIM_SETTLE_BAND 2.0 // Degrees
+#define SIM_MAX_EVENTS 8
+
+// Flight code state we grade it on
+extern Engines engines;
+extern unsigned long deltaTime;
+extern float currentRoll, currentPitch, currentHeading;
+extern float targetRoll, targetPitch, targetHeading;
+
+// Receiver pins, see Receiver.cpp
+#define PIN_ROLL 62
+#define PIN_THROTTLE 63
+#define PIN_PITCH 64
+#define PIN_YAW 65
+#define PIN_GEAR 66
+#define PIN_AUX 67
+
+///////////
+
+// Physics moves on whenever the flight code waits
+class SimClock : public HalClock
+{
+  public:
+    SimClock(QuadModel &model, SimSensors &sensors) : _model(model), _sensors(sensors), _now(0), _cost(0) {}
+    
+    unsigned long micros(){
+      return _now;
+    }
+    
+    void wait(unsigned long us){
+      std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+      
+      while (us){
+        unsigned long step = min(us, (unsigned long)SIM_STEP);
+        
+        _model.step(pulses(), step / 1000000.0);
+        _sensors.step(step / 1000000.0);
+        
+        _now += step;
+        us -= step;
+      }
+      
+      _cost += std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+    }
+    
+    // Host time spent in physics, so it can be left out of the flight code's
+    double getCost(){
+      return _cost;
+    }
+    
+  private:
+    QuadModel &_model;
+    SimSensors &_sensors;
+    unsigned long _now;
+    double _cost;
+    
+    // What's going out to the ESCs right now: the compare registers, at 2 timer ticks per microsecond
+    const uint16_t *pulses(){
+      static uint16_t widths[MODEL_MOTORS];
+      boolean running = (TCCR3B.raw() & 0x07) && (TCCR4B.raw() & 0x07);
+      
+      widths[0] = running ? OCR3B.raw() / 2 : 0; // Left front
+      widths[1] = running ? OCR3C.raw() / 2 : 0; // Right front
+      widths[2] = running ? OCR3A.raw() / 2 : 0; // Left rear
+      widths[3] = running ? OCR4A.raw() / 2 : 0; // Right rear
+      return widths;
+    }
+};
+
+///////////
+
+// What the pilot wants from the flight code during a scenario, in its terms: roll positive left side down, pitch
+// positive nose down, degrees
+struct Pilot {
+  double roll;
+  double pitch;
+};
+
+struct Scenario {
+  const char *name;
+  const char *description;
+  double length; // Seconds
+  void (*fly)(double t, double dT, Pilot &pilot, QuadModel &model);
+  double events[SIM_MAX_EVENTS]; // When something happens that it should settle after, 0 terminated
+};
+
+static void flyHover(double, double, Pilot &pilot, QuadModel &){
+  pilot.roll = 0;
+  pilot.pitch = 0;
+}
+
+static void flyRoll(double t, double, Pilot &pilot, QuadModel &){
+  pilot.roll = t < 2 ? 0 : (t < 5 ? 15 : (t < 8 ? -15 : 0));
+  pilot.pitch = 0;
+}
+
+static void flyPitch(double t, double, Pilot &pilot, QuadModel &){
+  pilot.roll = 0;
+  pilot.pitch = t < 2 ? 0 : (t < 5 ? 15 : (t < 8 ? -15 : 0));
+}
+
+// A knock on each axis, 0.1s long
+static void flyGust(double t, double dT, Pilot &pilot, QuadModel &model){
+  pilot.roll = 0;
+  pilot.pitch = 0;
+  
+  if (t >= 1.9 && t - dT < 1.9) model.push(Vector3(0.4, 0, 0), 0.1);
+  if (t >= 5.9 && t - dT < 5.9) model.push(Vector3(0, 0.4, 0), 0.1);
+}
+
+static const Scenario scenarios[] = {
+  { "hover", "Hold level for 10s", 10, flyHover, {0} },
+  { "roll", "15 degree roll steps", 11, flyRoll, {2, 5, 8, 0} },
+  { "pitch", "15 degree pitch steps", 11, flyPitch, {2, 5, 8, 0} },
+  { "gust", "Knocked in roll, then in pitch", 10, flyGust, {2, 6, 0} }
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+///////////
+
+struct Sample {
+  double time; // Since the scenario started
+  double target[2]; // Roll, pitch
+  double actual[2];
+  double estimate[2];
+};
+
+struct Result {
+  double rms;
+  double max;
+  double estimate; // RMS, of the flight code's attitude against the real one
+  double settle; // -1 if it never did, NAN if there was nothing to settle after
+  double loopTime;
+  double loopCost;
+  double speed;
+  double crashed; // When it crashed, seconds after setup(). 0 if it didn't
+  char how[32]; // What the crash was
+};
+
+static double stickPulse(double angle){
+  return 1500 + constrain(angle / RECEIVER_MAX_ANGLE, -1.0, 1.0) * 500;
+}
+
+static void setSticks(double roll, double pitch, double throttle, double yaw){
+  halSetPulse(PIN_ROLL, lround(roll));
+  halSetPulse(PIN_PITCH, lround(pitch));
+  halSetPulse(PIN_THROTTLE, lround(throttle));
+  halSetPulse(PIN_YAW, lround(yaw));
+  halSetPulse(PIN_GEAR, 1500);
+  halSetPulse(PIN_AUX, 1500);
+}
+
+// How long after each event until it stays within the band, the worst of them
+static double settling(const Scenario &scenario, const std::vector<Sample> &samples){
+  if (!scenario.events[0]) return NAN;
+  double worst = 0;
+  
+  for (uint8_t event = 0; event < SIM_MAX_EVENTS && scenario.events[event]; event++){
+    double start = scenario.events[event];
+    double end = (event + 1 < SIM_MAX_EVENTS && scenario.events[event + 1]) ? scenario.events[event + 1] : scenario.length;
+    double last = start;
+    bool settled = true;
+    
+    for (uint8_t axis = 0; axis < 2; axis++){
+      double before = 0, after = 0;
+      for (size_t i = 0; i < samples.size(); i++){
+        if (samples[i].time < start) before = samples[i].target[axis];
+        else{
+          after = samples[i].target[axis];
+          break;
+        }
+      }
+      double band = fmax(SIM_SETTLE_BAND, fabs(after - before) * 0.1);
+      
+      for (size_t i = 0; i < samples.size(); i++){
+        const Sample &sample = samples[i];
+        if (sample.time < start || sample.time >= end) continue;
+        
+        if (fabs(sample.actual[axis] - sample.target[axis]) > band){
+          last = fmax(last, sample.time);
+          if (i + 1 == samples.size() || samples[i + 1].time >= end) settled = false;
+        }
+      }
+    }
+    
+    if (!settled) return -1;
+    worst = fmax(worst, last - start);
+  }
+  
+  return worst;
+}
+
+static Result run(const Scenario &scenario, unsigned long loopCost, uint32_t seed, const SensorNoise &noise, bool baro, bool verbose, const char *commands){
+  QuadModel model((QuadParameters()));
+  SimSensors sensors(model, noise, seed);
+  SimClock clock(model, sensors);
+  
+  sensors.attach(baro);
+  halSetClock(&clock);
+  halSetAnalog(BATTERY_PIN, SIM_BATTERY);
+  setSticks(1500, 1500, 1000, 1500);
+  
+  setup();
+  
+  double start = model.getTime();
+  double hover = model.getHoverPulse();
+  double takeoff = 3; // When the pilot starts flying, after arming
+  double flying = takeoff + 3; // When the scenario starts
+  double end = flying + scenario.length;
+  
+  // On the ground, level, so this is where the accelerometer's zero is
+  halSerialInput(0, (const uint8_t *)"c", 1);
+  
+  std::vector<Sample> samples;
+  Pilot pilot = {0, 0};
+  unsigned long loops = 0;
+  double loopTimes = 0;
+  double cpu = 0;
+  double lastTime = 0;
+  double crashed = 0;
+  const char *how = "";
+  
+  std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+  
+  while (model.getTime() - start < end){
+    double t = model.getTime() - start;
+    
+    // Sticks: arm with the left stick bottom right, then hold altitude with the throttle like a pilot would
+    double throttle = 1000, yaw = 1500;
+    if (t >= 2 && t < 2.5) yaw = 2000;
+    if (t >= takeoff){
+      double altitude = -model.getPosition().z;
+      double climb = -model.getVelocity().z;
+      throttle = constrain(hover + 60 * (SIM_ALTITUDE - altitude) - 80 * climb, 1100.0, 1900.0);
+    }
+    
+    if (commands && t >= 1 && lastTime < 1) halSerialInput(0, (const uint8_t *)commands, strlen(commands));
+    
+    if (t >= flying){
+      scenario.fly(t - flying, t - lastTime, pilot, model);
+    }
+    setSticks(stickPulse(pilot.roll), stickPulse(pilot.pitch), throttle, yaw);
+    lastTime = t;
+    
+    std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+    double physics = clock.getCost();
+    loop();
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count() - (clock.getCost() - physics);
+    
+    clock.wait(loopCost);
+    halInterrupts();
+    
+    // Nobody's listening, unless we asked something
+    uint8_t output[256];
+    size_t length;
+    while ((length = halSerialOutput(0, output, sizeof(output)))){
+      if (commands && t >= 1 && t < takeoff) fwrite(output, 1, length, stdout);
+    }
+    
+    const Quaternion &attitude = model.getAttitude();
+    double roll = -attitude.getRoll() * 180 / M_PI; // Into the flight code's terms
+    double pitch = -attitude.getPitch() * 180 / M_PI;
+    double heading = fmod(attitude.getYaw() * 180 / M_PI + 360, 360);
+    
+    if (t >= takeoff && !engines.isArmed()) how = "disarmed";
+    else if (t >= takeoff && (fabs(roll) > 90 || fabs(pitch) > 90)) how = "turned over";
+    else if (t >= flying && model.getPosition().z >= 0) how = "hit the ground";
+    if (*how){
+      crashed = t;
+      break;
+    }
+    
+    if (verbose){
+      fprintf(stderr, "%.4f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%d,%d,%d,%d\n", t, targetRoll, roll, currentRoll,
+        targetPitch, pitch, currentPitch, targetHeading, heading, currentHeading, -model.getPosition().z,
+        engines.getEngineSpeed(0), engines.getEngineSpeed(1), engines.getEngineSpeed(2), engines.getEngineSpeed(3));
+    }
+    
+    if (t >= flying){
+      Sample sample = {t - flying, {targetRoll, targetPitch}, {roll, pitch}, {currentRoll, currentPitch}};
+      samples.push_back(sample);
+      
+      loops++;
+      loopTimes += deltaTime;
+      cpu += cost;
+    }
+  }
+  
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+  
+  Result result;
+  double squares = 0, estimates = 0;
+  result.max = 0;
+  for (size_t i = 0; i < samples.size(); i++){
+    for (uint8_t axis = 0; axis < 2; axis++){
+      double error = samples[i].actual[axis] - samples[i].target[axis];
+      squares += error * error / 2;
+      result.max = fmax(result.max, fabs(error));
+      
+      error = samples[i].estimate[axis] - samples[i].actual[axis];
+      estimates += error * error / 2;
+    }
+  }
+  result.rms = samples.empty() ? 0 : sqrt(squares / samples.size());
+  result.estimate = samples.empty() ? 0 : sqrt(estimates / samples.size());
+  result.settle = settling(scenario, samples);
+  result.loopTime = loops ? loopTimes / loops : 0;
+  result.loopCost = loops ? cpu / loops * 1000000 : 0;
+  result.speed = (model.getTime() - start) / wall;
+  result.crashed = crashed;
+  snprintf(result.how, sizeof(result.how), "%s", how);
+  
+  return result;
+}
+
+///////////
+
+static void usage(){
+  fprintf(stderr, "usage: quadsim [-l us] [-s seed] [-b] [-q] [-v] [-c commands] [scenario...]\n");
+  fprintf(stderr, "scenarios:\n");
+  for (size_t i = 0; i < SCENARIO_COUNT; i++){
+    fprintf(stderr, "  %-8s %s\n", scenarios[i].name, scenarios[i].description);
+  }
+  exit(1);
+}
+
+int main(int argc, char **argv){
+  unsigned long loopCost = SIM_LOOP_COST;
+  uint32_t seed = 1;
+  SensorNoise noise;
+  bool baro = true;
+  bool verbose = false;
+  const char *commands = 0;
+  
+  int opt;
+  while ((opt = getopt(argc, argv, "l:s:bqvc:")) != -1){
+    switch (opt){
+      case 'l':
+        loopCost = strtoul(optarg, 0, 10);
+        break;
+      case 's':
+        seed = strtoul(optarg, 0, 10);
+        break;
+      case 'b':
+        baro = false;
+        break;
+      case 'q':
+        noise = SensorNoise::none();
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'c':
+        commands = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  
+  std::vector<const Scenario *> chosen;
+  for (int i = optind; i < argc; i++){
+    const Scenario *found = 0;
+    for (size_t j = 0; j < SCENARIO_COUNT; j++){
+      if (!strcmp(argv[i], scenarios[j].name)) found = &scenarios[j];
+    }
+    if (!found) usage();
+    chosen.push_back(found);
+  }
+  if (chosen.empty()){
+    for (size_t i = 0; i < SCENARIO_COUNT; i++){
+      chosen.push_back(&scenarios[i]);
+    }
+  }
+  
+  printf("%-8s %8s %8s %8s %8s %8s %8s %8s\n", "scenario", "rms", "max", "estimate", "settle", "loop", "cpu", "speed");
+  printf("%-8s %8s %8s %8s %8s %8s %8s %8s\n", "", "(deg)", "(deg)", "(deg)", "(s)", "(us)", "(us)", "(x)");
+  
+  int failures = 0;
+  for (size_t i = 0; i < chosen.size(); i++){
+    // The flight code is all globals, so each scenario gets a fresh copy of it to power on
+    int pipes[2];
+    if (pipe(pipes)) return 1;
+    fflush(stdout);
+    
+    pid_t child = fork();
+    if (child == 0){
+      close(pipes[0]);
+      Result result = run(*chosen[i], loopCost, seed, noise, baro, verbose, commands);
+      fflush(stdout);
+      if (write(pipes[1], &result, sizeof(result)) != sizeof(result)) _exit(1);
+      _exit(0);
+    }
+    
+    close(pipes[1]);
+    Result result;
+    bool got = read(pipes[0], &result, sizeof(result)) == sizeof(result);
+    close(pipes[0]);
+    waitpid(child, 0, 0);
+    
+    if (!got){
+      printf("%-8s failed\n", chosen[i]->name);
+      failures++;
+      continue;
+    }
+    
+    if (result.crashed){
+      printf("%-8s crashed: %s at %.1fs\n", chosen[i]->name, result.how, result.crashed);
+      failures++;
+      continue;
+    }
+    
+    char settle[16];
+    if (isnan(result.settle)) snprintf(settle, sizeof(settle), "-");
+    else if (result.settle < 0) snprintf(settle, sizeof(settle), "never");
+    else snprintf(settle, sizeof(settle), "%.2f", result.settle);
+    
+    printf("%-8s %8.2f %8.2f %8.2f %8s %8.0f %8.1f %8.0f\n", chosen[i]->name, result.rms, result.max, result.estimate, settle,
+      result.loopTime, result.loopCost, result.speed);
+  }
+  
+  return failures ? 1 : 0;
+}
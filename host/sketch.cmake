@@ -0,0 +1,18 @@
+# Glue the .pde files together into one .cpp, the way the Arduino IDE (and the Rakefile) does
+# Run with -DSOURCE_DIR=<repo> -DOUTPUT=<file>
+
+set(PDE_FILES QuadCopter.pde FlightCommand.pde FlightControl.pde Parameters.pde SerialControl.pde)
+
+set(SKETCH "#include \"WProgram.h\"\n#include \"Sketch.h\"\n")
+foreach(PDE ${PDE_FILES})
+  file(READ "${SOURCE_DIR}/${PDE}" CONTENTS)
+  set(SKETCH "${SKETCH}#line 1 \"${SOURCE_DIR}/${PDE}\"\n${CONTENTS}\n")
+endforeach()
+
+# Only touch the output if it changed, so nothing rebuilds for no reason
+if(EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" PREVIOUS)
+endif()
+if(NOT "${PREVIOUS}" STREQUAL "${SKETCH}")
+  file(WRITE "${OUTPUT}" "${SKETCH}")
+endif()
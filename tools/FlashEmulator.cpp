@@ -0,0 +1,151 @@
+/*
+  FlashEmulator.cpp - A file pretending to be an SPI NOR flash chip, for running FlashLog on the host
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+#include <string.h>
+
+#include "FlashEmulator.h"
+
+// Opens (or creates) the image. A new one starts out erased, like a new chip
+FlashEmulator::FlashEmulator(const char *path, uint32_t size, unsigned long (*clock)()){
+  _size = size;
+  _clock = clock;
+  _busyUntil = 0;
+  _programming = false;
+  _errors = 0;
+  _programs = 0;
+  _erases = 0;
+  
+  _file = fopen(path, "r+b");
+  if (!_file){
+    _file = fopen(path, "w+b");
+    if (!_file) return;
+    
+    uint8_t erased[FLASH_SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for (uint32_t address = 0; address < _size; address += sizeof(erased)){
+      fwrite(erased, 1, sizeof(erased), _file);
+    }
+  }
+}
+
+FlashEmulator::~FlashEmulator(){
+  if (_file) fclose(_file);
+}
+
+bool FlashEmulator::isOpen(){
+  return _file != NULL;
+}
+
+uint32_t FlashEmulator::getSize(){
+  return _size;
+}
+
+bool FlashEmulator::isBusy(){
+  return (long)(_busyUntil - _clock()) > 0;
+}
+
+void FlashEmulator::read(uint32_t address, uint8_t *data, uint16_t length){
+  if (!check(!_programming && !isBusy(), "read while busy")) return;
+  if (!check(address + length <= _size, "read past the end")) return;
+  
+  fseek(_file, address, SEEK_SET);
+  if (fread(data, 1, length, _file) != length) memset(data, 0xFF, length);
+}
+
+void FlashEmulator::beginProgram(uint32_t address){
+  if (!check(!_programming && !isBusy(), "program while busy")) return;
+  if (!check(address < _size, "program past the end")) return;
+  
+  _programming = true;
+  _programAddress = address - address % FLASH_PAGE_SIZE;
+  _programStart = address % FLASH_PAGE_SIZE;
+  _programOffset = _programStart;
+  _programLength = 0;
+  memset(_page, 0xFF, sizeof(_page));
+  memset(_sent, 0, sizeof(_sent));
+}
+
+void FlashEmulator::program(const uint8_t *data, uint16_t length){
+  if (!check(_programming, "program without beginProgram")) return;
+  
+  for (uint16_t i=0; i<length; i++){
+    // A real chip wraps back to the start of the page, over what it was just sent
+    check(_programLength < FLASH_PAGE_SIZE - _programStart, "program crossed a page");
+    _page[_programOffset] &= data[i];
+    _sent[_programOffset] = true;
+    _programOffset = (_programOffset + 1) % FLASH_PAGE_SIZE;
+    _programLength++;
+  }
+}
+
+// Bits can only go from 1 to 0, so what's written is what was there AND what we were sent
+// Nothing we do should program the same byte twice without erasing it in between, so that's an error too
+void FlashEmulator::endProgram(){
+  if (!check(_programming, "endProgram without beginProgram")) return;
+  _programming = false;
+  
+  uint8_t page[FLASH_PAGE_SIZE];
+  fseek(_file, _programAddress, SEEK_SET);
+  if (fread(page, 1, sizeof(page), _file) != sizeof(page)) memset(page, 0xFF, sizeof(page));
+  
+  for (uint16_t i=0; i<FLASH_PAGE_SIZE; i++){
+    if (_sent[i]) check(page[i] == 0xFF, "program over data that wasn't erased");
+    page[i] &= _page[i];
+  }
+  
+  fseek(_file, _programAddress, SEEK_SET);
+  fwrite(page, 1, sizeof(page), _file);
+  
+  _busyUntil = _clock() + EMULATOR_PAGE_PROGRAM_TIME;
+  _programs++;
+}
+
+void FlashEmulator::eraseSector(uint32_t address){
+  if (!check(!_programming && !isBusy(), "erase while busy")) return;
+  if (!check(address < _size, "erase past the end")) return;
+  
+  uint8_t erased[FLASH_SECTOR_SIZE];
+  memset(erased, 0xFF, sizeof(erased));
+  fseek(_file, address - address % FLASH_SECTOR_SIZE, SEEK_SET);
+  fwrite(erased, 1, sizeof(erased), _file);
+  
+  _busyUntil = _clock() + EMULATOR_SECTOR_ERASE_TIME;
+  _erases++;
+}
+
+// Things a real chip would have ignored, or done something surprising with
+unsigned long FlashEmulator::getErrors(){
+  return _errors;
+}
+
+unsigned long FlashEmulator::getPrograms(){
+  return _programs;
+}
+
+unsigned long FlashEmulator::getErases(){
+  return _erases;
+}
+
+// Count (and report the first few of) anything that isn't ok
+bool FlashEmulator::check(bool ok, const char *what){
+  if (ok) return true;
+  
+  if (_errors++ < 10) fprintf(stderr, "flash emulator: %s\n", what);
+  return false;
+}
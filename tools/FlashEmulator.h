@@ -0,0 +1,81 @@
+/*
+  FlashEmulator.h - A file pretending to be an SPI NOR flash chip, for running FlashLog on the host
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+#ifndef FlashEmulator_h
+#define FlashEmulator_h
+
+#include <stdio.h>
+
+#include "FlashLog.h"
+
+// Typical times for a W25Q-series chip, in microseconds
+#define EMULATOR_PAGE_PROGRAM_TIME 700
+#define EMULATOR_SECTOR_ERASE_TIME 45000
+
+//
+// Behaves like the real thing where it matters to FlashLog: programming can only clear bits, only erasing sets
+// them again, a program wraps around inside its page, and the chip ignores everything while it's busy. Anything a
+// real chip would have ignored or mangled is counted in getErrors(), so a test can insist on none.
+//
+// Time comes from the clock function (in microseconds), so a simulation can run faster than real time.
+//
+class FlashEmulator : public FlashChip
+{
+  public:
+    FlashEmulator(const char *path, uint32_t size, unsigned long (*clock)());
+    ~FlashEmulator();
+    
+    bool isOpen();
+    
+    uint32_t getSize();
+    bool isBusy();
+    
+    void read(uint32_t address, uint8_t *data, uint16_t length);
+    
+    void beginProgram(uint32_t address);
+    void program(const uint8_t *data, uint16_t length);
+    void endProgram();
+    
+    void eraseSector(uint32_t address);
+    
+    unsigned long getErrors();
+    unsigned long getPrograms();
+    unsigned long getErases();
+    
+  private:
+    FILE *_file;
+    uint32_t _size;
+    unsigned long (*_clock)();
+    unsigned long _busyUntil;
+    
+    bool _programming;
+    uint32_t _programAddress; // Where the page being programmed starts
+    uint16_t _programStart; // Where in it we started
+    uint16_t _programOffset; // Where the next byte goes
+    uint16_t _programLength;
+    uint8_t _page[FLASH_PAGE_SIZE];
+    bool _sent[FLASH_PAGE_SIZE]; // Which bytes of _page we were actually sent
+    
+    unsigned long _errors;
+    unsigned long _programs;
+    unsigned long _erases;
+    
+    bool check(bool, const char *);
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+  bbdecode.cpp - Turn a blackbox dump into CSV
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Usage:
+//   bbdecode capture.bin   What came back from the serial port after an 'l' command (or - for stdin), e.g.
+//                          printf l > /dev/ttyUSB0; cat /dev/ttyUSB0 > capture.bin
+//
+// Prints a header and one line per frame, with the values back in their usual units, and a summary on stderr.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Telemetry.h"
+#include "Blackbox.h"
+
+static const char *names[BLACKBOX_FIELDS] = {
+  "deltaTime", "roll", "pitch", "heading", "targetRoll", "targetPitch", "targetHeading",
+  "gyroRoll", "gyroPitch", "gyroYaw", "rollAdjust", "pitchAdjust", "headingAdjust",
+  "throttle", "motor0", "motor1", "motor2", "motor3", "motor4", "motor5"
+};
+
+// What each field was multiplied by before it was recorded
+static double scale(int field){
+  if (field >= BLACKBOX_ROLL && field <= BLACKBOX_GYRO_YAW) return 100.0;
+  if (field >= BLACKBOX_ROLL_ADJUST && field <= BLACKBOX_HEADING_ADJUST) return 10.0;
+  return 1.0;
+}
+
+int main(int argc, char **argv){
+  if (argc != 2){
+    fprintf(stderr, "usage: %s <file>\n", argv[0]);
+    return 2;
+  }
+  
+  FILE *in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+  if (!in){
+    perror(argv[1]);
+    return 1;
+  }
+  
+  // Put the dump back together from its pieces
+  TelemetryDecoder telemetry;
+  std::vector<uint8_t> dump;
+  std::vector<bool> have;
+  bool complete = false;
+  int c;
+  
+  while (!complete && (c = fgetc(in)) != EOF){
+    if (!telemetry.push((uint8_t)c) || telemetry.getType() != TELEMETRY_BLACKBOX) continue;
+    if (telemetry.getLength() < sizeof(TelemetryBlackbox)) continue;
+    
+    TelemetryBlackbox header;
+    memcpy(&header, telemetry.getPayload(), sizeof(header));
+    uint8_t length = telemetry.getLength() - sizeof(header);
+    
+    dump.resize(header.total);
+    have.resize(header.total);
+    if (header.offset + length > header.total) continue;
+    
+    memcpy(&dump[header.offset], telemetry.getPayload() + sizeof(header), length);
+    for (int i=0; i<length; i++){
+      have[header.offset + i] = true;
+    }
+    
+    complete = header.offset == header.total;
+  }
+  
+  size_t missing = 0;
+  for (size_t i=0; i<have.size(); i++){
+    if (!have[i]) missing++;
+  }
+  if (!complete || missing){
+    fprintf(stderr, "incomplete dump: %s, %lu of %lu bytes missing\n", complete ? "got the end" : "no end marker",
+      (unsigned long)missing, (unsigned long)dump.size());
+  }
+  
+  // Then decode it
+  BlackboxDecoder decoder;
+  unsigned long frames = 0;
+  
+  for (int i=0; i<BLACKBOX_FIELDS; i++){
+    printf(i ? ",%s" : "%s", names[i]);
+  }
+  printf("\n");
+  
+  for (size_t i=0; i<dump.size(); i++){
+    if (!decoder.push(dump[i])) continue;
+    
+    for (int f=0; f<BLACKBOX_FIELDS; f++){
+      if (f) printf(",");
+      if (scale(f) == 1.0) printf("%ld", (long)decoder.getField(f));
+      else printf("%g", decoder.getField(f) / scale(f));
+    }
+    printf("\n");
+    frames++;
+  }
+  
+  fprintf(stderr, "%lu frames from %lu bytes, %lu skipped waiting for a keyframe, %lu telemetry errors\n",
+    frames, (unsigned long)dump.size(), decoder.getSkipped(), telemetry.getErrors());
+  return complete && !missing ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+  flashsim.cpp - Fly the flash blackbox against an emulated chip and check what comes back
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Usage:
+//   flashsim [-f flights] [-s seconds] [-c] [-e] image.bin
+//
+// Records made-up flights at 400Hz through Blackbox and FlashLog, exactly as the flight code does, into an
+// emulated chip backed by image.bin (created erased if it isn't there, and kept, so runs can follow each other).
+// -c cuts the power during the last flight: nothing is flushed, and whatever hadn't been programmed is lost.
+// -e erases the log first, like the 'k' command, and then sends it again while that erase is still going.
+//
+// Then it "reboots", finds the end of the log again, reads the whole thing back and decodes it, and checks that
+// every frame that came out is one that went in, in order. Prints what happened and exits non-zero if it isn't
+// right. Time is simulated, so an hour of flying takes seconds.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "FlashLog.h"
+#include "Blackbox.h"
+#include "FlashEmulator.h"
+
+#define FLASH_SIZE (2UL * 1024 * 1024) // A W25Q16
+#define LOOP_TIME 2500 // Microseconds, 400Hz
+
+struct Frame {
+  int32_t fields[BLACKBOX_FIELDS];
+};
+
+static unsigned long now = 0;
+
+static unsigned long simulatedMicros(){
+  return now;
+}
+
+// Something that moves like a flight, with a bit of noise so the changes aren't all the same
+static void makeFrame(unsigned long frame, int32_t *fields){
+  double t = frame * LOOP_TIME / 1000000.0;
+  
+  fields[BLACKBOX_DELTA_TIME] = LOOP_TIME + rand() % 40 - 20;
+  fields[BLACKBOX_ROLL] = 1500 * sin(t * 1.3) + rand() % 30;
+  fields[BLACKBOX_PITCH] = 1200 * sin(t * 0.7) + rand() % 30;
+  fields[BLACKBOX_HEADING] = (long)(t * 1000) % 36000;
+  fields[BLACKBOX_TARGET_ROLL] = 1500 * sin(t * 1.3);
+  fields[BLACKBOX_TARGET_PITCH] = 1200 * sin(t * 0.7);
+  fields[BLACKBOX_TARGET_HEADING] = 0;
+  fields[BLACKBOX_GYRO_ROLL] = 1950 * cos(t * 1.3) + rand() % 200 - 100;
+  fields[BLACKBOX_GYRO_PITCH] = 840 * cos(t * 0.7) + rand() % 200 - 100;
+  fields[BLACKBOX_GYRO_YAW] = rand() % 200 - 100;
+  fields[BLACKBOX_ROLL_ADJUST] = rand() % 100 - 50;
+  fields[BLACKBOX_PITCH_ADJUST] = rand() % 100 - 50;
+  fields[BLACKBOX_HEADING_ADJUST] = rand() % 20 - 10;
+  fields[BLACKBOX_THROTTLE] = 1500 + 100 * sin(t * 0.2);
+  
+  for (int i=0; i<6; i++){
+    fields[BLACKBOX_MOTORS + i] = i < 4 ? fields[BLACKBOX_THROTTLE] + rand() % 50 : 0;
+  }
+}
+
+int main(int argc, char **argv){
+  int flights = 3;
+  int seconds = 60;
+  bool cut = false;
+  bool erase = false;
+  int opt;
+  
+  while ((opt = getopt(argc, argv, "f:s:ce")) != -1){
+    switch (opt){
+      case 'f': flights = atoi(optarg); break;
+      case 's': seconds = atoi(optarg); break;
+      case 'c': cut = true; break;
+      case 'e': erase = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-f flights] [-s seconds] [-c] [-e] image.bin\n", argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1){
+    fprintf(stderr, "usage: %s [-f flights] [-s seconds] [-c] [-e] image.bin\n", argv[0]);
+    return 2;
+  }
+  
+  std::vector<Frame> expected; // Everything that made it into the log
+  unsigned long recorded = 0;
+  uint32_t startLength;
+  
+  {
+    FlashEmulator chip(argv[optind], FLASH_SIZE, simulatedMicros);
+    if (!chip.isOpen()){
+      perror(argv[optind]);
+      return 1;
+    }
+    
+    FlashLog log(&chip);
+    Blackbox blackbox(&log);
+    log.begin();
+    
+    if (erase){
+      blackbox.erase();
+      for (int i=0; i<3; i++){
+        log.update();
+        now += LOOP_TIME;
+      }
+      
+      // A second 'k' before the first has finished
+      blackbox.erase();
+      while (!log.isIdle()){
+        log.update();
+        now += LOOP_TIME;
+      }
+    }
+    startLength = log.getLength();
+    
+    for (int flight = 0; flight < flights; flight++){
+      blackbox.start();
+      
+      for (unsigned long frame = 0; frame < (unsigned long)seconds * 1000000 / LOOP_TIME; frame++){
+        Frame f;
+        makeFrame(frame, f.fields);
+        
+        unsigned long dropped = log.getDropped();
+        blackbox.record(f.fields);
+        if (log.getDropped() == dropped) expected.push_back(f);
+        recorded++;
+        
+        log.update();
+        now += LOOP_TIME;
+      }
+      
+      if (cut && flight == flights - 1) break; // No freeze, so no flush: the power's gone
+      
+      blackbox.freeze();
+      while (!log.isIdle()){
+        log.update();
+        now += LOOP_TIME;
+      }
+      
+      // Sit on the ground for a bit
+      for (int i=0; i<400; i++){
+        log.update();
+        now += LOOP_TIME;
+      }
+    }
+    
+    printf("recorded %lu frames, %lu dropped, %lu bytes logged (%lu before we started)\n", recorded,
+      log.getDropped(), (unsigned long)(log.getLength() - startLength), (unsigned long)startLength);
+    printf("%lu page programs, %lu sector erases, %lu flash errors\n", chip.getPrograms(), chip.getErases(),
+      chip.getErrors());
+    
+    if (chip.getErrors()) return 1;
+  }
+  
+  // Reboot, find the end again, and read it all back
+  now += 1000000;
+  FlashEmulator chip(argv[optind], FLASH_SIZE, simulatedMicros);
+  FlashLog log(&chip);
+  log.begin();
+  
+  std::vector<uint8_t> dump(log.getLength());
+  for (uint32_t offset = 0; offset < dump.size(); offset += FLASH_PAGE_SIZE){
+    uint16_t length = dump.size() - offset < FLASH_PAGE_SIZE ? dump.size() - offset : FLASH_PAGE_SIZE;
+    log.read(offset, &dump[offset], length);
+  }
+  
+  // Frames from earlier runs are in the log too, so only check the ones that end past the padding Blackbox::start()
+  // put at the front of ours. Anything ending inside it is what was left of a frame cut short by -c last time
+  uint32_t first = startLength ? startLength + BLACKBOX_MAX_FRAME : 0;
+  BlackboxDecoder decoder;
+  std::vector<Frame> decoded;
+  unsigned long total = 0;
+  for (size_t i = 0; i < dump.size(); i++){
+    if (!decoder.push(dump[i])) continue;
+    
+    total++;
+    if (i < first) continue;
+    
+    Frame f;
+    for (int field = 0; field < BLACKBOX_FIELDS; field++){
+      f.fields[field] = decoder.getField(field);
+    }
+    decoded.push_back(f);
+  }
+  
+  size_t next = 0;
+  unsigned long matched = 0;
+  unsigned long wrong = 0;
+  
+  for (size_t i = 0; i < decoded.size(); i++){
+    size_t j = next;
+    while (j < expected.size() && memcmp(&decoded[i], &expected[j], sizeof(Frame)) != 0) j++;
+    
+    if (j == expected.size()){
+      wrong++;
+      continue;
+    }
+    
+    matched++;
+    next = j + 1;
+  }
+  
+  printf("after reboot: %lu bytes in the log, %lu frames decoded, %lu skipped\n", (unsigned long)log.getLength(),
+    total, decoder.getSkipped());
+  printf("%lu of %lu frames that went in came back, %lu that came back weren't ones that went in\n", matched,
+    (unsigned long)expected.size(), wrong);
+  
+  bool ok = !wrong && chip.getErrors() == 0;
+  if (!cut) ok = ok && matched == expected.size();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+/*
+  groundstation.cpp - Record the ASCII telemetry streams and keep an eye on the link
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Usage:
+//   groundstation [-b baud] [-q query] [-r rate] [-o out.csv] <device or file>
+//   groundstation -B
+//
+//   -b  Baud rate if the input is a serial port (default 115200)
+//   -q  Sent to the craft first, e.g. -q '&' for the AeroQuad style stream, or -q '+&;50;' to subscribe
+//   -r  The rate the stream should arrive at, in Hz, to work out how much we're losing
+//   -o  Record every good line, with the host time it arrived in microseconds, as CSV
+//   -B  Benchmark the line parser on made up '&' lines and exit
+//
+// Understands the '&', 'S' and 'Q' streams, with or without the stream letter a subscription puts in front.
+// Once a second it prints the lines received, bad lines, estimated loss, link throughput, and the loop time
+// percentiles from the craft's deltaTime.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#define MAX_FIELDS 32
+#define LOOP_WINDOW 2000 // How many loop times the percentiles are over
+
+struct Stats {
+  unsigned long lines;
+  unsigned long bad;
+  unsigned long bytes;
+  std::vector<unsigned long> loopTimes;
+  size_t loopIndex;
+};
+
+static unsigned long long hostMicros(){
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// How many values each stream sends. '&' depends on the frame type, so it's either
+static bool fieldCountOK(char stream, int count){
+  switch (stream){
+    case '&': return count == 24 || count == 26;
+    case 'S': return count == 17;
+    case 'Q': return count == 12;
+  }
+  return count > 0;
+}
+
+// Split a line up into numbers. stream is the letter in front of it, if there was one, otherwise defaultStream
+// Returns the number of fields, or -1 if the line isn't one we understand
+static int parseLine(const char *line, char defaultStream, char *stream, double *fields){
+  *stream = defaultStream;
+  if ((isalpha((unsigned char)line[0]) || line[0] == '&') && line[1] == ','){
+    *stream = line[0];
+    line += 2;
+  }
+  
+  int count = 0;
+  while (*line){
+    if (count == MAX_FIELDS) return -1;
+    
+    char *end;
+    fields[count++] = strtod(line, &end);
+    if (end == line) return -1;
+    
+    line = end;
+    if (*line == ',') line++;
+    else if (*line) return -1;
+  }
+  
+  return fieldCountOK(*stream, count) ? count : -1;
+}
+
+static void addLoopTime(Stats *stats, unsigned long loopTime){
+  if (stats->loopTimes.size() < LOOP_WINDOW){
+    stats->loopTimes.push_back(loopTime);
+  }
+  else{
+    stats->loopTimes[stats->loopIndex] = loopTime;
+    stats->loopIndex = (stats->loopIndex + 1) % LOOP_WINDOW;
+  }
+}
+
+static void printStats(Stats *stats, Stats *last, double elapsed, double rate){
+  unsigned long lines = stats->lines - last->lines;
+  
+  fprintf(stderr, "%lu lines (%.1f/s), %lu bad", stats->lines, lines / elapsed, stats->bad);
+  if (rate > 0){
+    double loss = 1.0 - lines / (rate * elapsed);
+    fprintf(stderr, ", %.1f%% lost", loss > 0 ? loss * 100 : 0.0);
+  }
+  fprintf(stderr, ", %.0f B/s", (stats->bytes - last->bytes) / elapsed);
+  
+  if (!stats->loopTimes.empty()){
+    std::vector<unsigned long> sorted(stats->loopTimes);
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    fprintf(stderr, ", loop us p50 %lu p90 %lu p99 %lu max %lu", sorted[n / 2], sorted[n * 9 / 10], sorted[n * 99 / 100], sorted[n - 1]);
+  }
+  fprintf(stderr, "\n");
+  
+  last->lines = stats->lines;
+  last->bytes = stats->bytes;
+}
+
+static speed_t baudConstant(long baud){
+  switch (baud){
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+  }
+  return 0;
+}
+
+static int openInput(const char *path, long baud){
+  int fd = strcmp(path, "-") == 0 ? 0 : open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) fd = open(path, O_RDONLY); // A recording we can't write to
+  if (fd < 0 || !isatty(fd)) return fd;
+  
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0){
+    cfmakeraw(&tio);
+    speed_t speed = baudConstant(baud);
+    if (speed){
+      cfsetispeed(&tio, speed);
+      cfsetospeed(&tio, speed);
+    }
+    else{
+      fprintf(stderr, "unsupported baud rate %ld, leaving it alone\n", baud);
+    }
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  
+  return fd;
+}
+
+static int benchmark(){
+  const int count = 200000;
+  std::vector<char> text;
+  char line[256];
+  
+  srand(1);
+  for (int i=0; i<count; i++){
+    int length = snprintf(line, sizeof(line), "&,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d,%d,%.2f,%.2f,%.2f,%d,%d,%d,%d,%d,1,0,%d",
+      2400 + rand() % 200, (rand() % 9000) / 100.0, -(rand() % 9000) / 100.0, (rand() % 36000) / 100.0,
+      (rand() % 18000) / 100.0, (rand() % 18000) / 100.0, (rand() % 18000) / 100.0,
+      (rand() % 20000) / 100.0 - 100, (rand() % 20000) / 100.0 - 100, (rand() % 20000) / 100.0 - 100,
+      rand() % 1000 - 500, rand() % 1000 - 500, rand() % 1000 - 500,
+      (rand() % 50000) / 100.0, (rand() % 1300) / 100.0, 1.0 + (rand() % 30) / 100.0,
+      1000 + rand() % 1000, 1000 + rand() % 1000, 1000 + rand() % 1000, 1000 + rand() % 1000, 1000 + rand() % 1000,
+      rand() % 2000);
+    text.insert(text.end(), line, line + length + 1);
+  }
+  
+  double fields[MAX_FIELDS];
+  char stream;
+  unsigned long good = 0;
+  
+  unsigned long long start = hostMicros();
+  for (size_t offset = 0; offset < text.size(); offset += strlen(&text[offset]) + 1){
+    if (parseLine(&text[offset], '&', &stream, fields) > 0) good++;
+  }
+  double seconds = (hostMicros() - start) / 1000000.0;
+  
+  double bytesPerSecond = text.size() / seconds;
+  printf("%lu/%d lines in %.3fs: %.0f lines/s, %.1f MB/s, %.0fx what 115200 baud can carry\n",
+    good, count, seconds, count / seconds, bytesPerSecond / 1000000, bytesPerSecond / 11520);
+  return good == (unsigned long)count ? 0 : 1;
+}
+
+int main(int argc, char **argv){
+  long baud = 115200;
+  const char *query = NULL;
+  const char *output = NULL;
+  double rate = 0;
+  int opt;
+  
+  while ((opt = getopt(argc, argv, "b:q:r:o:B")) != -1){
+    switch (opt){
+      case 'b': baud = atol(optarg); break;
+      case 'q': query = optarg; break;
+      case 'r': rate = atof(optarg); break;
+      case 'o': output = optarg; break;
+      case 'B': return benchmark();
+      default:
+        fprintf(stderr, "usage: %s [-b baud] [-q query] [-r rate] [-o out.csv] <device or file>\n       %s -B\n", argv[0], argv[0]);
+        return 2;
+    }
+  }
+  
+  if (optind != argc - 1){
+    fprintf(stderr, "usage: %s [-b baud] [-q query] [-r rate] [-o out.csv] <device or file>\n       %s -B\n", argv[0], argv[0]);
+    return 2;
+  }
+  
+  int fd = openInput(argv[optind], baud);
+  if (fd < 0){
+    perror(argv[optind]);
+    return 1;
+  }
+  
+  FILE *out = NULL;
+  if (output){
+    out = fopen(output, "w");
+    if (!out){
+      perror(output);
+      return 1;
+    }
+  }
+  
+  // Which stream un-prefixed lines belong to: whatever we asked for the AeroQuad way
+  char defaultStream = '&';
+  if (query && query[0] != '+' && query[0] != '-') defaultStream = query[0];
+  
+  if (query && write(fd, query, strlen(query)) < 0){
+    perror("write");
+  }
+  
+  Stats stats = Stats();
+  Stats last = Stats();
+  char buffer[4096];
+  char line[512];
+  size_t length = 0;
+  double fields[MAX_FIELDS];
+  
+  unsigned long long lastPrint = hostMicros();
+  
+  for (;;){
+    ssize_t got = read(fd, buffer, sizeof(buffer));
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) break;
+    
+    unsigned long long now = hostMicros();
+    stats.bytes += got;
+    
+    for (ssize_t i=0; i<got; i++){
+      char c = buffer[i];
+      if (c == '\r') continue;
+      if (c != '\n'){
+        if (length < sizeof(line) - 1) line[length++] = c;
+        continue;
+      }
+      
+      line[length] = '\0';
+      length = 0;
+      if (!line[0]) continue;
+      
+      char stream;
+      int count = parseLine(line, defaultStream, &stream, fields);
+      if (count < 0){
+        stats.bad++;
+        continue;
+      }
+      
+      stats.lines++;
+      if (stream == '&' || stream == 'S') addLoopTime(&stats, (unsigned long)fields[0]);
+      
+      if (out){
+        const char *values = (line[1] == ',' && line[0] == stream) ? line + 2 : line;
+        fprintf(out, "%llu,%c,%s\n", now, stream, values);
+      }
+    }
+    
+    if (now - lastPrint >= 1000000){
+      printStats(&stats, &last, (now - lastPrint) / 1000000.0, rate);
+      lastPrint = now;
+    }
+  }
+  
+  printStats(&stats, &last, std::max((hostMicros() - lastPrint) / 1000000.0, 0.001), 0);
+  
+  if (out) fclose(out);
+  if (fd != 0) close(fd);
+  return 0;
+}
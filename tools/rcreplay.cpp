@@ -0,0 +1,96 @@
+/*
+  rcreplay.cpp - Replay a recorded RC receiver stream through the same decoders the flight code uses
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Usage:
+//   rcreplay sbus capture.bin   Raw bytes as they came off the (un-inverted) S.BUS wire
+//   rcreplay ppm widths.txt     Whitespace separated pulse-to-pulse times in microseconds, e.g. from a logic analyzer
+//
+// Prints one line per decoded frame: the channels in microseconds, comma separated. "make check" replays the streams
+// in testdata/ and compares them with what they should decode to.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "PPMDecoder.h"
+#include "SBusDecoder.h"
+
+static int replaySBus(FILE *in){
+  SBusDecoder sbus;
+  unsigned long frames = 0;
+  int c;
+  
+  while ((c = fgetc(in)) != EOF){
+    if (!sbus.push((uint8_t)c)) continue;
+    
+    for (uint8_t i=0; i<SBUS_CHANNELS; i++){
+      printf("%u,", sbus.getChannel(i));
+    }
+    printf("0x%02x\n", sbus.getFlags());
+    frames++;
+  }
+  
+  fprintf(stderr, "%lu frames, %lu errors\n", frames, sbus.getErrors());
+  return 0;
+}
+
+static int replayPPM(FILE *in){
+  PPMDecoder ppm;
+  unsigned long frames = 0;
+  unsigned int width;
+  
+  while (fscanf(in, "%u", &width) == 1){
+    // On the board, updateAll() watches a gap grow before it ends. All we have is how long it ended up, so offer
+    // idle() that first
+    bool complete = ppm.idle((uint16_t)width);
+    if (ppm.push((uint16_t)width)) complete = true;
+    if (!complete) continue;
+    
+    for (uint8_t i=0; i<ppm.getChannelCount(); i++){
+      printf(i == 0 ? "%u" : ",%u", ppm.getChannel(i));
+    }
+    printf("\n");
+    frames++;
+  }
+  
+  fprintf(stderr, "%lu frames\n", frames);
+  return 0;
+}
+
+int main(int argc, char **argv){
+  if (argc != 3){
+    fprintf(stderr, "usage: %s sbus|ppm <file>\n", argv[0]);
+    return 2;
+  }
+  
+  bool sbus = strcmp(argv[1], "sbus") == 0;
+  if (!sbus && strcmp(argv[1], "ppm") != 0){
+    fprintf(stderr, "unknown receiver type: %s\n", argv[1]);
+    return 2;
+  }
+  
+  FILE *in = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], sbus ? "rb" : "r");
+  if (!in){
+    perror(argv[2]);
+    return 1;
+  }
+  
+  return sbus ? replaySBus(in) : replayPPM(in);
+}
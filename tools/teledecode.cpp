@@ -0,0 +1,81 @@
+/*
+  teledecode.cpp - Decode the binary telemetry stream the flight code sends after an 'a' command
+  Created by Myles Grant <myles@mylesgrant.com>
+  See also: https://github.com/grantmd/QuadCopter
+  
+  This program is free software: you can redistribute it and/or modify 
+  it under the terms of the GNU General Public License as published by 
+  the Free Software Foundation, either version 3 of the License, or 
+  (at your option) any later version. 
+
+  This program is distributed in the hope that it will be useful, 
+  but WITHOUT ANY WARRANTY; without even the implied warranty of 
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the 
+  GNU General Public License for more details. 
+
+  You should have received a copy of the GNU General Public License 
+  along with this program. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+//
+// Usage:
+//   teledecode capture.bin   Raw bytes captured from the serial port (or - for stdin), e.g.
+//                            printf a > /dev/ttyUSB0; cat /dev/ttyUSB0 | teledecode -
+//
+// Prints the same columns as the ASCII '&' stream, one line per good frame, and a summary on stderr. The one difference
+// is the gyro rates, which are in degrees/second here rather than radians/second.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Telemetry.h"
+
+static void printFlight(const TelemetryFlight *r){
+  printf("%lu,%.2f,%.2f,%.2f,", (unsigned long)r->deltaTime, r->roll / 100.0, r->pitch / 100.0, r->heading / 100.0);
+  printf("%.2f,%.2f,%.2f,", r->accelAngle[0] / 100.0, r->accelAngle[1] / 100.0, r->accelAngle[2] / 100.0);
+  printf("%.2f,%.2f,%.2f,", r->gyro[0] / 100.0, r->gyro[1] / 100.0, r->gyro[2] / 100.0);
+  printf("%d,%d,%d,", r->mag[0], r->mag[1], r->mag[2]);
+  printf("%.2f,%.3f,%.3f,", r->altitude / 100.0, r->battery / 1000.0, r->compensation / 1000.0);
+  printf("%u,", r->throttle);
+  for (int i=0; i<6; i++){
+    printf("%u,", r->engines[i]);
+  }
+  printf("%u,%u,%u\n", r->armed, r->mode, r->telemetryTime);
+}
+
+int main(int argc, char **argv){
+  if (argc != 2){
+    fprintf(stderr, "usage: %s <file>\n", argv[0]);
+    return 2;
+  }
+  
+  FILE *in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+  if (!in){
+    perror(argv[1]);
+    return 1;
+  }
+  
+  TelemetryDecoder decoder;
+  unsigned long frames = 0, bytes = 0, unknown = 0;
+  int c;
+  
+  while ((c = fgetc(in)) != EOF){
+    bytes++;
+    if (!decoder.push((uint8_t)c)) continue;
+    
+    if (decoder.getType() == TELEMETRY_FLIGHT && decoder.getLength() == sizeof(TelemetryFlight)){
+      TelemetryFlight record;
+      memcpy(&record, decoder.getPayload(), sizeof(record));
+      printFlight(&record);
+      frames++;
+    }
+    else{
+      unknown++;
+    }
+  }
+  
+  fprintf(stderr, "%lu frames (%lu bytes each), %lu unknown, %lu errors, %lu bytes read\n",
+    frames, (unsigned long)(sizeof(TelemetryFlight) + TELEMETRY_OVERHEAD), unknown, decoder.getErrors(), bytes);
+  return 0;
+}